@@ -3,6 +3,8 @@
 //					into a binary tree
 //	DESIGNER:		River Stahley
 //	FUNCTIONS:		main - Initiates program & calls CreateTree, OpenFiles & DestroyTree
+//					ParseOptions - reads command line options
+//					DisplayUsage - displays command line options
 //					OpenFiles - opens and validates text files
 //					ReadFiles - upon validation, reads text file data into binary tree
 //					Menu - calls MenuSelect, ValidateSelect & ProcessSelect
@@ -14,17 +16,163 @@
 //					CreateNode - allocates and fills a new node
 //					InsertNode - inserts a new node into the tree
 //					FindNode - searches for a value in the tree
-//					DeleteNode - deletes a node from the tree
-//					InOrderDisplay - displays all integers in tree (recursive in-order)
+//					LocateNode - finds a node along with its parent and link
+//					DeleteKey - finds and deletes a value in one descent
+//					CreateCache - allocates an empty hot-key cache
+//					ClearCache - empties the hot-key cache
+//					CacheSlot - maps an integer to its cache slot
+//					LookupNode - searches for a value through the hot-key cache
+//					InvalidateCache - drops an integer from the hot-key cache
+//					BenchHotKeys - times skewed lookups with and without cache
+//					BuildIndex - builds a learned index over the tree's integers
+//					IndexFind - searches for a value in the learned index
+//					BenchIndex - times tree, binary search and learned index lookups
+//					BenchGeneric - times the int tree against BinaryTree<int, int>
+//					DeleteNode - deletes a located node from the tree
+//					InsertBatch - inserts a batch of integers in one merged traversal
+//					InsertRun - merges a sorted run of integers into a subtree
+//					BuildSubtree - builds a balanced subtree from a sorted run
+//					DeleteBatch - deletes a batch of integers in one merged traversal
+//					DeleteRun - removes a sorted run of integers from a subtree
+//					RemoveNode - unlinks and de-allocates a single node
+//					InOrderDisplay - displays all integers in tree (in-order)
 //					FreeNodes - recursively de-allocates all memory from the tree
 //					DestroyTree - de-allocates all nodes from the tree
+//					CollectKeys - lists all integers in the tree in order
+//					CollectNodes - lists all integers in a subtree in order
+//					SyncFile - forces a file to stable storage
+//					ReadSnapshot - loads a compacted snapshot
+//					OpenLog - replays, compacts and attaches the operation log
+//					ReplayLog - applies logged changes to the tree
+//					CompactLog - writes a snapshot and starts an empty log
+//					LogRecord - queues a change for the next group commit
+//					LogOffset - queues the text file position held by the log
+//					CommitLog - appends and syncs queued changes
+//					CloseLog - commits and detaches the operation log
+//					EncodeNum - stores an integer as 4 little-endian bytes
+//					DecodeNum - reads an integer stored as 4 bytes
+//					LogChecksum - computes the check byte of a log record
+//					ResetParser - clears an incremental text parser
+//					ParseChunk - parses integers from a block of text
+//					EndNumber - stores the integer being parsed
+//					LoadFile - reads a text file with reads kept in flight
+//					LoadBlock - parses and inserts a block read by the loader
+//					ThreadLoad - loads a text file using a read-ahead thread
+//					ReadAhead - read-ahead thread, fills the buffer ring
+//					UringLoad - loads a text file using io_uring
+//					OpenRing - creates and maps an io_uring instance
+//					SubmitRead - queues a read of one block
+//					WaitRead - waits for a queued read to complete
+//					CloseRing - unmaps and closes an io_uring instance
+//					StartFollow - starts following a growing data file
+//					FollowFile - follow thread, waits for file changes
+//					FollowPass - parses and inserts newly appended data
+//					ApplyFollowBatch - inserts a batch of followed integers
+//					StopFollow - stops following the data file
+//					RangeKeys - lists integers between two bounds
+//					RangeNodes - lists subtree integers between two bounds
+//					StopServer - signal handler, stops the server
+//					OpenSocket - opens a Unix domain or localhost TCP socket
+//					ServeRequests - serves tree requests (epoll + worker pool)
+//					AcceptConns - accepts pending client connections
+//					ReadConn - reads pipelined requests from a connection
+//					DispatchConn - hands a batch of requests to the workers
+//					FlushConn - sends queued responses
+//					ServiceConn - dispatches, closes or re-arms a connection
+//					CloseConn - closes a client connection
+//					ReapConns - frees closed connections
+//					ServerWorker - worker thread, executes request batches
+//					ExecuteBatch - executes a batch under one tree lock
+//					RunClient - load generator, reports throughput/latency
+//					ClientConnection - load generator connection thread
+//					ParseBytes - reads a byte count option
+//					BlockBytes - finds the bytes reserved for an allocation
+//					NodeCost - finds the bytes reserved for one node
+//					MeasureMemory - adds up the memory used by the tree
+//					NodeMemory - adds up the memory used by a subtree
+//					FootprintBytes - estimates the memory used by the tree
+//					BudgetRoom - finds how many integers fit the memory limit
+//					SetInsertLimit - adds an integer to the compressed set within the limit
+//					SetBytes - finds the bytes an integer's container holds
+//					CompactTree - moves the tree into a compressed set
+//					DisplayMemory - displays the memory used by the tree
+//					CreateSet - allocates an empty compressed integer set
+//					BitCount - counts the set bits in a bitmap word
+//					LowestBit - finds the lowest set bit in a bitmap word
+//					FindContainer - locates the container for an integer
+//					ContainerValues - lists the members of a container
+//					ContainerRebuild - re-encodes a container as array or bitmap
+//					ContainerFind - searches for an integer in a container
+//					SetInsert - adds an integer to the compressed set
+//					SetFind - searches for an integer in the compressed set
+//					SetDelete - removes an integer from the compressed set
+//					ContainerOptimize - converts a container to runs if smaller
+//					SetOptimize - converts containers to runs where smaller
+//					SetOptimizeKey - optimizes the container holding an integer
+//					SetDisplay - displays all integers in the set (in-order)
+//					DestroySet - de-allocates the compressed set
+//					BinaryTree - generic binary tree over key/value pairs
 //***************************************************************************************
 
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <climits>
+#include <cmath>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <random>
+#include <condition_variable>
+#include <deque>
+#include <set>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define HAVE_IO_URING
+#endif
+#endif
 
 
 using namespace std;
@@ -38,52 +186,669 @@ struct node
 	node *right;
 };
 
+// pending run of a batch
+// batch traversals keep these on an explicit stack, since the tree
+// may be far deeper than the call stack allows
+
+struct runTask
+{
+	node **link;		// subtree the run belongs to
+	int first;			// index of first integer in run
+	int last;			// index one past the last integer in run
+	bool visited;		// children already handled (DeleteRun)
+};
+
+// node handle structure
+// result of LocateNode - the node plus the path leading to it
+
+struct nodeHandle
+{
+	node *found;		// matching node (NULL - not found)
+	node *parent;		// parent of matching node (NULL - node is the root)
+	node **link;		// link holding the node, or where it would be linked
+};
+
+// hot-key cache limits
+
+const int HOT_CACHE_BITS = 14;						// log2 of cache slots
+const int HOT_CACHE_SLOTS = 1 << HOT_CACHE_BITS;	// direct-mapped slots
+
+// hot-key cache slot
+
+struct hotSlot
+{
+	int num;			// cached integer
+	node *found;		// node holding it (NULL - slot is empty)
+};
+
+// hot-key cache structure
+// direct-mapped cache of recently found nodes, in front of FindNode
+
+struct hotCache
+{
+	hotSlot slots[HOT_CACHE_SLOTS];
+	long long hits;			// lookups answered by the cache
+	long long misses;		// lookups that descended the tree
+};
+
+// hot-key benchmark settings
+
+const int BENCH_KEYS = 1000000;			// integers in the benchmark tree
+const int BENCH_LOOKUPS = 5000000;		// lookups per timed run
+const double ZIPF_EXPONENT = 0.99;		// skew of the hot-key workload
+
+// learned index limits
+
+const int INDEX_ERROR = 16;				// largest position error of a segment
+const int INDEX_RADIX_BITS = 20;		// largest radix table prefix
+
+// learned index segment
+// predicts the position of key k as start + slope * (k - firstKey)
+
+struct indexSegment
+{
+	int firstKey;		// smallest integer in the segment
+	int start;			// position of firstKey
+	double slope;		// positions per unit of integer
+};
+
+// learned index structure
+// read-only copy of the tree's integers with a piecewise linear model,
+// used by the --bench-index benchmark only; searches go to the tree
+
+struct learnedIndex
+{
+	vector<int> keys;					// integers in order
+	vector<indexSegment> segments;		// models, ordered by firstKey
+	vector<int> radix;					// first segment per integer prefix
+	int minKey;							// smallest integer
+	int shift;							// prefix = (k - minKey) >> shift
+};
+
+// compressed set container limits
+
+const int ARRAY_MAX = 4096;			// largest array container
+const int BITMAP_WORDS = 1024;		// 64-bit words in a bitmap container
+const uint32_t SET_SIGN_BIT = 0x80000000u;	// flipped so containers keep signed order
+
+// compressed set container kinds
+
+enum containerKind
+{
+	ARRAY_CONTAINER,		// sorted low 16 bits, for sparse chunks
+	BITMAP_CONTAINER,		// 65536-bit bitmap, for dense chunks
+	RUN_CONTAINER			// sorted (start, length - 1) pairs, for clustered chunks
+};
+
+// compressed set container
+// holds every integer sharing the same upper 16 bits (sign bit flipped)
+
+struct setContainer
+{
+	uint16_t high;					// upper 16 bits of every member
+	containerKind kind;				// container representation
+	int cardinality;				// number of members
+	vector<uint16_t> values;		// ARRAY and RUN contents
+	vector<uint64_t> bits;			// BITMAP contents
+};
+
+// compressed integer set structure
+// Roaring-style alternative to the pointer tree for dense key ranges
+
+struct intSet
+{
+	vector<setContainer> containers;	// sorted by high
+};
+
+// operation log limits and file formats
+
+const char LOG_SUFFIX[] = ".wal";				// appended to the data filename
+const char SNAPSHOT_SUFFIX[] = ".snap";			// appended to the data filename
+const char LOG_MAGIC[8] = {'B','T','W','A','L','0','0','1'};
+const char SNAPSHOT_MAGIC[8] = {'B','T','S','N','A','P','0','2'};
+const char OLD_SNAPSHOT_MAGIC[8] = {'B','T','S','N','A','P','0','1'};	// no text offset
+const int LOG_RECORD_BYTES = 6;				// op, 4-byte integer, check byte
+const int COMPACT_RECORDS = 4096;			// log records forcing compaction
+
+// operation log structure
+// append-only record of changes made since the last snapshot
+
+struct opLog
+{
+	FILE *file;							// log opened for appending
+	string logName;						// log filename
+	string snapName;					// snapshot filename
+	vector<unsigned char> pending;		// records awaiting group commit
+	int pendingCount;					// number of records awaiting commit
+	mutex queueLock;					// guards pending and pendingCount
+	mutex writeLock;					// held while a commit writes and syncs,
+										// so commits keep queue order
+	int records;						// number of records in the log file
+	long long textOffset;				// bytes of the text file held by the
+										// snapshot and log
+};
+
 // binary tree structure
 
 struct binaryTree
 {
 	int count;
 	node *root;
+	intSet *set;		// compressed backend (NULL - pointer tree is used)
+	opLog *log;			// operation log (NULL - changes are not saved)
+	hotCache *cache;	// hot-key cache (NULL - every lookup descends)
+	bool quiet;			// skip per-integer messages (background batches)
+	long long maxBytes;	// memory limit (0 - unlimited)
+	long long roomLeft;	// bytes known to be free without measuring again
+	bool compactOnLimit;	// limit reached - switch to the compressed set
+							// (false - reject inserts)
+	shared_mutex lock;	// serializes the menu with background ingestion;
+						// taken shared by read-only server batches
+};
+
+// memory accounting
+// allocated bytes include what the allocator reserves around each block
+
+struct memoryUsage
+{
+	long long nodes;			// pointer tree nodes
+	long long nodeBytes;		// bytes requested for nodes
+	long long setBytes;			// bytes requested for the compressed set
+	long long cacheBytes;		// bytes requested for the hot-key cache
+	long long logBytes;			// bytes requested for the operation log
+	long long overheadBytes;	// allocator headers and rounding
+	long long totalBytes;		// all of the above and the tree structure
+	long long heapBytes;		// process heap from the system (0 - unknown)
+	long long heapFreeBytes;	// free bytes held in the process heap
+};
+
+// text file reading limits
+
+const int READ_CHUNK_BYTES = 65536;		// bytes read from a text file at once
+const int FOLLOW_BATCH = 4096;			// followed integers inserted at once
+const int FOLLOW_POLL_MS = 200;			// wait between checks for new data
+
+// incremental text parser
+// carries an integer that is split across blocks of text
+
+struct textParser
+{
+	long long value;		// magnitude of the integer being parsed
+	int digits;				// digits of the integer being parsed
+	int pendingBytes;		// characters of the integer being parsed
+	bool negative;			// integer being parsed has a '-' sign
+	bool failed;			// non-integer text found - parsing stopped
+};
+
+// asynchronous loader limits
+
+const int LOAD_BUFFERS = 4;					// reads kept in flight
+const int LOAD_BUFFER_BYTES = 1 << 20;		// bytes per read
+const int LOAD_INSERT_BATCH = 1 << 20;		// parsed integers inserted at once
+
+// loader timings
+
+struct loadStats
+{
+	long long bytes;		// bytes of the text file read
+	double ioWait;			// seconds spent waiting for reads
+	double cpu;				// seconds spent parsing and inserting
+	const char *method;		// "io_uring" or "read-ahead thread" or both
+};
+
+// read-ahead buffer
+
+struct loadBuffer
+{
+	vector<char> data;		// block of the text file
+	long long size;			// bytes in the block (0 - end of file)
+	bool ready;				// filled, owned by the loader until parsed
+};
+
+// read-ahead thread structure
+// used when io_uring is not available
+
+struct readAhead
+{
+	string filename;						// file being read
+	long long offset;						// file position to read from
+	loadBuffer buffers[LOAD_BUFFERS];		// ring of blocks, filled in order
+	mutex lock;								// guards ready, size and stop
+	condition_variable changed;				// signalled when a buffer changes hands
+	bool stop;								// loader needs no more blocks
+	thread worker;							// read-ahead thread
+};
+
+#ifdef HAVE_IO_URING
+
+// io_uring submission and completion rings
+
+struct uringQueue
+{
+	int ringFd;					// io_uring instance
+	void *sqRing;				// mapped submission ring
+	void *cqRing;				// mapped completion ring
+	size_t sqRingBytes;			// size of the submission ring mapping
+	size_t cqRingBytes;			// size of the completion ring mapping
+	size_t sqeBytes;			// size of the submission entries mapping
+	unsigned *sqTail;			// next submission entry
+	unsigned *sqMask;			// submission ring index mask
+	unsigned *sqArray;			// submission ring of entry indexes
+	io_uring_sqe *sqes;			// submission entries
+	unsigned *cqHead;			// next completion to collect
+	unsigned *cqTail;			// end of completions
+	unsigned *cqMask;			// completion ring index mask
+	io_uring_cqe *cqes;			// completions
+};
+
+#endif
+
+// file follower structure
+// background ingestion of integers appended to the data file
+
+struct fileFollower
+{
+	binaryTree *tree;			// tree receiving new integers
+	string filename;			// file being followed
+	long long offset;			// bytes of the file already parsed
+	textParser parser;			// state carried between reads
+	atomic<bool> stop;			// set to end the follow thread
+	thread worker;				// follow thread
+};
+
+// request server protocol
+// request:  op 'I', 'F', 'D' or 'R' (1 byte), integer (4 bytes),
+//			 range end for 'R' (4 bytes)
+// response: status (1 byte), n (4 bytes), n integers for 'R' (4 bytes each)
+// integers are little-endian, responses are sent in request order
+
+const int REQUEST_BYTES = 9;			// size of every request
+const int RESPONSE_BYTES = 5;			// size of a response before integers
+const unsigned char STATUS_OK = 0;		// done / found
+const unsigned char STATUS_MISSING = 1;	// duplicate insert / not found
+const unsigned char STATUS_BAD_REQUEST = 2;	// unknown op or invalid integer
+const unsigned char STATUS_NO_ROOM = 3;		// insert refused at the memory limit
+
+// request server limits
+
+const int MAX_BATCH_REQUESTS = 256;		// requests executed per tree lock
+const int MAX_RANGE_KEYS = 65536;		// integers returned per range request
+const int MAX_CONN_INPUT = 262144;		// received bytes held per connection
+const int SERVER_EVENTS = 64;			// descriptors handled per epoll_wait
+const int CLIENT_KEY_RANGE = 1000000;	// load generator integers 1..this
+const int CLIENT_RANGE_WIDTH = 64;		// load generator range request width
+
+// server connection
+// owned by the event loop; input and output are never touched by workers
+
+struct serverConn
+{
+	int fd;								// client socket
+	vector<unsigned char> input;		// received bytes not yet dispatched
+	vector<unsigned char> output;		// responses not yet sent
+	size_t sent;						// bytes of output already sent
+	bool busy;							// a batch is at the worker pool
+	bool closed;						// socket closed, free when idle
+	bool writing;						// responses wait for socket space
+	bool peerDone;						// peer finished sending (half-close)
+	unsigned events;					// epoll events registered
+};
+
+// batch of requests from one connection
+
+struct serverJob
+{
+	serverConn *conn;					// connection the batch came from
+	vector<unsigned char> requests;		// complete requests
+	vector<unsigned char> responses;	// encoded responses
+};
+
+// request server structure
+
+struct requestServer
+{
+	binaryTree *tree;					// tree being served
+	int listenFd;						// listening socket
+	int epollFd;						// event loop
+	int wakeFd;							// eventfd signalled by workers
+	mutex queueLock;					// guards jobs and stopping
+	condition_variable queueReady;		// signalled when a job is queued
+	deque<serverJob*> jobs;				// batches waiting for a worker
+	bool stopping;						// workers should exit
+	mutex doneLock;						// guards done
+	vector<serverJob*> done;			// batches waiting for the loop
+	vector<thread> workers;				// worker pool
+	set<serverConn*> conns;				// open and closing connections
+};
+
+// command line options
+
+struct options
+{
+	bool compact;		// store integers in a compressed set
+	bool persist;		// log changes and reload them at startup
+	bool follow;		// keep inserting integers appended to the file
+	bool hotCache;		// cache recently found nodes
+	bool benchHot;		// run the hot-key benchmark and exit
+	bool benchIndex;	// run the learned index benchmark and exit
+	bool benchGeneric;	// run the generic tree benchmark and exit
+	bool serve;			// serve requests instead of showing the menu
+	bool client;		// run the load generator and exit
+	bool loadTimes;		// report I/O wait and CPU time of the load
+	bool uring;			// load the text file with io_uring if available
+	string address;		// server socket path or localhost TCP port
+	int workers;		// server worker threads
+	int connections;	// load generator connections
+	int requests;		// load generator requests per connection
+	int depth;			// load generator pipeline depth
+	long long maxMem;	// memory limit in bytes (0 - unlimited)
+	bool compactOnLimit;	// limit reached - switch to the compressed set
+};
+
+// generic binary tree class
+// same layout and algorithms as node/binaryTree, over arbitrary key/value
+// pairs; integral keys with the default comparator compile down to the
+// plain '<' / '==' comparisons used by the int tree
+
+template <class Key, class Value, class Compare = less<Key>,
+		  class Allocator = allocator<pair<const Key, Value> > >
+class BinaryTree
+{
+	public:
+		struct treeNode
+		{
+			pair<const Key, Value> entry;
+			treeNode *left;
+			treeNode *right;
+			
+			template <class K, class... Args>
+			treeNode (K&& key, Args&&... args)
+				: entry (piecewise_construct, forward_as_tuple (std::forward<K>(key)),
+						 forward_as_tuple (std::forward<Args>(args)...)),
+				  left (NULL), right (NULL) {}
+		};
+		
+		BinaryTree (const Compare& compare = Compare(),
+					const Allocator& alloc = Allocator());
+		BinaryTree (BinaryTree&& other) noexcept;
+		BinaryTree& operator= (BinaryTree&& other)
+			noexcept (allocator_traits<Allocator>::propagate_on_container_move_assignment::value
+					  || allocator_traits<Allocator>::is_always_equal::value);
+		BinaryTree (const BinaryTree&) = delete;
+		BinaryTree& operator= (const BinaryTree&) = delete;
+		~BinaryTree();
+		
+		int Count() const { return count; }
+		bool IsEmpty() const { return root == NULL; }
+		
+		template <class... Args>
+		pair<Value*, bool> Emplace (const Key& key, Args&&... args);
+		template <class... Args>
+		pair<Value*, bool> Emplace (Key&& key, Args&&... args);
+		pair<Value*, bool> Insert (const Key& key, Value&& value);
+		pair<Value*, bool> Insert (const Key& key, const Value& value);
+		pair<Value*, bool> Insert (Key&& key, Value&& value);
+		Value* Find (const Key& key);
+		const Value* Find (const Key& key) const;
+		bool Delete (const Key& key);
+		template <class Visit>
+		void InOrder (Visit visit) const;
+		void Clear();
+		
+	private:
+		typedef typename allocator_traits<Allocator>::template rebind_alloc<treeNode> nodeAllocator;
+		typedef allocator_traits<nodeAllocator> nodeTraits;
+		
+		// integral keys ordered by less<> use the int tree's comparisons
+		
+		static constexpr bool plainKey = is_integral<Key>::value
+										 && (is_same<Compare, less<Key> >::value
+											 || is_same<Compare, less<> >::value);
+		
+		bool Less (const Key& a, const Key& b) const;
+		bool Equal (const Key& a, const Key& b) const;
+		treeNode** Locate (const Key& key) const;
+		template <class K, class... Args>
+		pair<Value*, bool> EmplaceKey (K&& key, Args&&... args);
+		void FreeNodes (treeNode* root);
+		
+		treeNode *root;
+		int count;
+		Compare compare;
+		nodeAllocator alloc;
 };
 
 // prototypes
 
-int OpenFiles (binaryTree *newTree, string& filename);	
-int ReadFiles (binaryTree *newTree, string& filename);
+long long OpenFiles (binaryTree *newTree, string& filename, options& opts);	
+long long ReadFiles (binaryTree *newTree, string& filename, options& opts, long long offset);
 int Menu (binaryTree* newTree);
 void MenuSelect (char& selection);
 bool ValidateSelect (char& selection);
 bool ValidateNum (int& num);
 void ProcessSelect (binaryTree *newTree, char& selection);
 binaryTree* CreateTree();
-bool IsEmpty (node* root);
+bool ParseOptions (int argc, char* argv[], options& opts);
+void DisplayUsage (const char* program);
+bool IsEmpty (binaryTree* newTree);
 node* CreateNode (int num); 
 void InsertNode (binaryTree *newTree, int insertNum);
 bool FindNode (binaryTree *newTree, int searchNum);
-void DeleteNode (binaryTree *newTree);
+nodeHandle LocateNode (binaryTree *newTree, int searchNum);
+bool DeleteKey (binaryTree *newTree, int deleteNum);
+hotCache* CreateCache();
+void ClearCache (hotCache *cache);
+int CacheSlot (int num);
+node* LookupNode (binaryTree *newTree, int searchNum);
+void InvalidateCache (binaryTree *newTree, int num);
+void BenchHotKeys();
+learnedIndex* BuildIndex (binaryTree *newTree);
+bool IndexFind (learnedIndex *index, int searchNum);
+void BenchIndex();
+void BenchGeneric();
+void DeleteNode (binaryTree *newTree, nodeHandle& handle);
+int InsertBatch (binaryTree *newTree, vector<int>& batch);
+void InsertRun (binaryTree *newTree, node*& link, const int* keys, int first, int last);
+node* BuildSubtree (binaryTree *newTree, const int* keys, int first, int last);
+int DeleteBatch (binaryTree *newTree, vector<int>& batch);
+void DeleteRun (binaryTree *newTree, node*& link, const int* keys, int first, int last);
+void RemoveNode (binaryTree *newTree, node*& link);
 void InOrderDisplay (node* root);
 void FreeNodes (node* root);
 void DestroyTree (binaryTree* newTree); 
+void CollectKeys (binaryTree *newTree, vector<int>& keys);
+void CollectNodes (node* root, vector<int>& keys);
+bool SyncFile (FILE *file);
+bool ReadSnapshot (binaryTree *newTree, string& filename, long long& offset);
+bool OpenLog (binaryTree *newTree, string& filename, long long offset);
+int ReplayLog (binaryTree *newTree, opLog *log, bool& torn);
+bool CompactLog (binaryTree *newTree, opLog *log);
+void LogRecord (binaryTree *newTree, char op, int num);
+void LogOffset (binaryTree *newTree, long long offset);
+bool CommitLog (binaryTree *newTree);
+void CloseLog (binaryTree *newTree);
+void EncodeNum (uint32_t num, unsigned char* bytes);
+int DecodeNum (const unsigned char* bytes);
+unsigned char LogChecksum (const unsigned char* record);
+void ResetParser (textParser& parser);
+void ParseChunk (textParser& parser, const char* data, long long size, vector<int>& nums);
+void EndNumber (textParser& parser, vector<int>& nums);
+long long LoadFile (binaryTree *newTree, string& filename, textParser& parser,
+					vector<int>& batch, loadStats& stats, bool uring, long long offset);
+void LoadBlock (binaryTree *newTree, textParser& parser, vector<int>& batch,
+				const char* data, long long size, loadStats& stats);
+long long ThreadLoad (binaryTree *newTree, string& filename, textParser& parser,
+					  vector<int>& batch, loadStats& stats, long long offset);
+void ReadAhead (readAhead *reader);
+#ifdef HAVE_IO_URING
+long long UringLoad (binaryTree *newTree, string& filename, textParser& parser,
+					 vector<int>& batch, loadStats& stats, long long offset);
+bool OpenRing (uringQueue& ring, unsigned entries);
+bool SubmitRead (uringQueue& ring, int fd, char* buffer, long long offset, int slot);
+bool WaitRead (uringQueue& ring, long long* results, int slot);
+void CloseRing (uringQueue& ring);
+#endif
+fileFollower* StartFollow (binaryTree *newTree, string& filename, long long offset);
+void FollowFile (fileFollower *follower);
+void FollowPass (fileFollower *follower);
+void ApplyFollowBatch (fileFollower *follower, vector<int>& batch);
+void StopFollow (fileFollower *follower);
+void RangeKeys (binaryTree *newTree, int low, int high, vector<int>& keys, int limit);
+void RangeNodes (node* root, int low, int high, vector<int>& keys, int limit);
+int ServeRequests (binaryTree *newTree, options& opts);
+int RunClient (options& opts);
+#ifdef __linux__
+void StopServer (int signum);
+int OpenSocket (const string& address, bool listening);
+void AcceptConns (requestServer *server);
+bool ReadConn (serverConn *conn);
+void DispatchConn (requestServer *server, serverConn *conn);
+bool FlushConn (serverConn *conn);
+void ServiceConn (requestServer *server, serverConn *conn);
+void CloseConn (requestServer *server, serverConn *conn);
+void ReapConns (requestServer *server);
+void ServerWorker (requestServer *server);
+void ExecuteBatch (binaryTree *newTree, serverJob *job);
+void ClientConnection (options *opts, int index, vector<double> *latencies,
+					   mutex *resultLock, int *failures);
+#endif
+intSet* CreateSet();
+int BitCount (uint64_t word);
+int LowestBit (uint64_t word);
+int FindContainer (intSet *set, uint16_t high);
+void ContainerValues (const setContainer& chunk, vector<uint16_t>& lows);
+void ContainerRebuild (setContainer& chunk);
+bool ContainerFind (const setContainer& chunk, uint16_t low);
+bool SetInsert (intSet *set, int num);
+bool SetFind (intSet *set, int num);
+bool SetDelete (intSet *set, int num);
+void ContainerOptimize (setContainer& chunk, vector<uint16_t>& lows);
+void SetOptimize (intSet *set);
+void SetOptimizeKey (intSet *set, int num);
+void SetDisplay (intSet *set);
+void DestroySet (intSet *set);
+bool ParseBytes (const string& text, long long& bytes);
+long long BlockBytes (const void* block, size_t size);
+long long NodeCost();
+void MeasureMemory (binaryTree *newTree, memoryUsage& usage);
+void NodeMemory (node* root, memoryUsage& usage);
+long long FootprintBytes (binaryTree *newTree);
+int BudgetRoom (binaryTree *newTree, int adding);
+int SetInsertLimit (binaryTree *newTree, int num);
+long long SetBytes (intSet *set, int num);
+bool CompactTree (binaryTree *newTree);
+void DisplayMemory (binaryTree *newTree);
 
 //********************************************************************************
 //  FUNCTION:	  main
 //  DESCRIPTION:  Initiates program & calls 3 functions
-//  INPUT:        Parameters: None
+//  INPUT:        Parameters: argc, argv - command line options
 //  OUTPUT: 	  Return value: 0 indicating program exited successfully
-//  CALLS TO:	  CreateTree, OpenFiles, DestroyTree
+//								1 - invalid command line options
+//  CALLS TO:	  ParseOptions, BenchHotKeys, BenchIndex, BenchGeneric, RunClient,
+//				  CreateTree, CreateSet, CreateCache, OpenFiles, StartFollow,
+//				  ServeRequests, Menu, StopFollow, CloseLog, DestroyTree
 //*******************************************************************************
 
-int main()
+int main(int argc, char* argv[])
 {
 	string filename;	// data filename
+	options opts;		// command line options
+	long long loaded;	// bytes of the data file loaded
+	fileFollower *follower = NULL;	// background ingestion
+	
+	// call ParseOptions
+	
+	if (!ParseOptions (argc, argv, opts))
+	{
+		return 1;
+	}
+	
+	// benchmark mode - call BenchHotKeys
+	
+	if (opts.benchHot)
+	{
+		BenchHotKeys();
+		return 0;
+	}
+	
+	// benchmark mode - call BenchIndex
+	
+	if (opts.benchIndex)
+	{
+		BenchIndex();
+		return 0;
+	}
+	
+	// benchmark mode - call BenchGeneric
+	
+	if (opts.benchGeneric)
+	{
+		BenchGeneric();
+		return 0;
+	}
+	
+	// load generator mode - call RunClient
+	
+	if (opts.client)
+	{
+		return RunClient (opts);
+	}
 
 	// call CreateTree
 	
 	binaryTree *searchTree = CreateTree();
+	searchTree->maxBytes = opts.maxMem;
+	searchTree->compactOnLimit = opts.compactOnLimit;
+	
+	// compressed mode - call CreateSet
+	
+	if (opts.compact)
+	{
+		searchTree->set = CreateSet();
+	}
+	
+	// hot-key mode - call CreateCache
+	
+	if (opts.hotCache)
+	{
+		searchTree->cache = CreateCache();
+	}
 
 	// call OpenFiles
 	
-	OpenFiles (searchTree, filename);
+	loaded = OpenFiles (searchTree, filename, opts);
+	
+	// follow mode - call StartFollow
+	
+	if (opts.follow)
+	{
+		follower = StartFollow (searchTree, filename, loaded);
+	}
+	
+	// server mode - call ServeRequests
+	// otherwise call Menu
+	
+	if (opts.serve)
+	{
+		ServeRequests (searchTree, opts);
+	}
+	
+	else
+	{
+		Menu (searchTree);
+	}
+	
+	// call StopFollow
+	
+	if (follower != NULL)
+	{
+		StopFollow (follower);
+	}
+	
+	// call CloseLog
+	
+	CloseLog (searchTree);
 	
 	// call DestroyTree
 	
@@ -92,20 +857,212 @@ int main()
 	return 0;
 }
 
+//*****************************************************************************
+//  FUNCTION:	  ParseOptions
+//  DESCRIPTION:  reads command line options
+//  INPUT:        Parameters:	argc, argv - command line options
+//								opts - parsed options
+//  OUTPUT: 	  Return value: true (valid options)
+//								false (invalid options, usage displayed)
+//  CALLS TO:	  ParseBytes
+//*****************************************************************************
+
+bool ParseOptions (int argc, char* argv[], options& opts)
+{
+	string option;		// current command line option
+	string value;		// text after '=' in the option
+	int number;			// numeric option value
+	long long bytes;	// byte count option value
+	size_t equals;		// position of '=' in the option
+	bool flag;			// option has no value
+	
+	// defaults
+	
+	opts.compact = false;
+	opts.persist = false;
+	opts.follow = false;
+	opts.hotCache = false;
+	opts.benchHot = false;
+	opts.benchIndex = false;
+	opts.benchGeneric = false;
+	opts.serve = false;
+	opts.client = false;
+	opts.loadTimes = false;
+	opts.uring = true;
+	opts.address = "binary-tree.sock";
+	opts.workers = max (2, (int)thread::hardware_concurrency());
+	opts.connections = 4;
+	opts.requests = 100000;
+	opts.depth = 32;
+	opts.maxMem = 0;
+	opts.compactOnLimit = false;
+	
+	for (int i = 1; i < argc; i++)
+	{
+		option = argv[i];
+		equals = option.find ('=');
+		value = (equals == string::npos) ? "" : option.substr (equals + 1);
+		option = option.substr (0, equals);
+		number = atoi (value.c_str());
+		flag = (equals == string::npos);
+		
+		if (option == "--compact" && flag)
+		{
+			opts.compact = true;
+		}
+		
+		else if (option == "--persist" && flag)
+		{
+			opts.persist = true;
+		}
+		
+		else if (option == "--follow" && flag)
+		{
+			opts.follow = true;
+		}
+		
+		else if (option == "--hot-cache" && flag)
+		{
+			opts.hotCache = true;
+		}
+		
+		else if (option == "--bench-hot" && flag)
+		{
+			opts.benchHot = true;
+		}
+		
+		else if (option == "--bench-index" && flag)
+		{
+			opts.benchIndex = true;
+		}
+		
+		else if (option == "--bench-generic" && flag)
+		{
+			opts.benchGeneric = true;
+		}
+		
+		else if (option == "--serve" && flag)
+		{
+			opts.serve = true;
+		}
+		
+		else if (option == "--client" && flag)
+		{
+			opts.client = true;
+		}
+		
+		else if (option == "--load-stats" && flag)
+		{
+			opts.loadTimes = true;
+		}
+		
+		else if (option == "--no-uring" && flag)
+		{
+			opts.uring = false;
+		}
+		
+		else if (option == "--socket" && !value.empty())
+		{
+			opts.address = value;
+		}
+		
+		else if (option == "--workers" && number > 0)
+		{
+			opts.workers = number;
+		}
+		
+		else if (option == "--connections" && number > 0)
+		{
+			opts.connections = number;
+		}
+		
+		else if (option == "--requests" && number > 0)
+		{
+			opts.requests = number;
+		}
+		
+		else if (option == "--depth" && number > 0)
+		{
+			opts.depth = number;
+		}
+		
+		else if (option == "--max-mem" && ParseBytes (value, bytes))
+		{
+			opts.maxMem = bytes;
+		}
+		
+		else if (option == "--over-limit" && (value == "reject" || value == "compact"))
+		{
+			opts.compactOnLimit = (value == "compact");
+		}
+		
+		// unknown option, missing value or value given to a flag -
+		// display usage
+		
+		else
+		{
+			cerr << "Error - invalid option " << argv[i] << endl;
+			DisplayUsage (argv[0]);
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DisplayUsage
+//  DESCRIPTION:  displays command line options
+//  INPUT:        Parameters:	program - program name
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void DisplayUsage (const char* program)
+{
+	cerr << "Usage: " << program << " [options]" << endl;
+	cerr << "  --compact          store integers in a compressed integer set" << endl;
+	cerr << "  --persist          log changes and reload them at startup" << endl;
+	cerr << "  --follow           keep inserting integers appended to the file" << endl;
+	cerr << "  --hot-cache        cache recently found integers for repeated searches" << endl;
+	cerr << "  --bench-hot        time skewed searches with and without the cache" << endl;
+	cerr << "  --bench-index      time the learned index against the tree and binary search" << endl;
+	cerr << "                     (the index is not used by searches)" << endl;
+	cerr << "  --bench-generic    time BinaryTree<int, int> against the int tree" << endl;
+	cerr << "  --serve            serve requests on the socket instead of the menu" << endl;
+	cerr << "  --client           run the load generator against a server" << endl;
+	cerr << "  --load-stats       report I/O wait and CPU time of loading the file" << endl;
+	cerr << "  --no-uring         load with a read-ahead thread instead of io_uring" << endl;
+	cerr << "  --socket=ADDRESS   socket path, or a localhost TCP port number" << endl;
+	cerr << "                     (default binary-tree.sock)" << endl;
+	cerr << "  --workers=N        server worker threads" << endl;
+	cerr << "  --connections=N    load generator connections (default 4)" << endl;
+	cerr << "  --requests=N       load generator requests per connection (default 100000)" << endl;
+	cerr << "  --depth=N          load generator pipeline depth (default 32)" << endl;
+	cerr << "  --max-mem=BYTES    memory limit for the tree (K, M or G suffix allowed)" << endl;
+	cerr << "  --over-limit=MODE  at the limit: reject inserts, or compact into a" << endl;
+	cerr << "                     compressed integer set (default reject)" << endl;
+}
+
 //*****************************************************************************
 //  FUNCTION:	  OpenFiles
 //  DESCRIPTION:  opens and validates text files
 //  INPUT:        Parameters:	newTree - pointer to new binary tree
 //								filename - data filename
-//  OUTPUT: 	  Return value: 1 - if user chooses to exit program
-//  CALLS TO:	  ReadFiles, Menu
+//								opts - command line options
+//  OUTPUT: 	  Return value: bytes of the text file loaded
+//  CALLS TO:	  ReadSnapshot, OpenLog, FootprintBytes, ReadFiles, CompactLog
 //*****************************************************************************
 
-int OpenFiles (binaryTree *newTree, string& filename)
+long long OpenFiles (binaryTree *newTree, string& filename, options& opts)
 {
-	ifstream infile;	// for reading text file
-	int cursor;		// position of the cursor
-	int exit;		// early exit
+	ifstream infile;		// for reading text file
+	long long cursor;		// position of the cursor
+	long long start = 0;	// bytes of the text file already in the tree
+	long long loaded;		// bytes of the text file loaded
+	long long limit;		// memory limit, lifted while restoring
+	long long used;			// bytes used by the restored integers
+	opLog *log;				// operation log, detached while loading
 
 	// prompt user for filename
 	
@@ -134,34 +1091,85 @@ int OpenFiles (binaryTree *newTree, string& filename)
 	cursor = infile.tellg();
 	infile.close();
 	
-	// file is empty call Menu function
+	// persistent mode - the snapshot and log hold the text file up to the
+	// offset they record, only text appended after it is read
+	// call ReadSnapshot, then OpenLog
 	
-	if (cursor == 0)
+	if (opts.persist)
 	{
-		// Display total number of integers in binary search tree
-
-		cout << endl;
-		cout << "There are " << newTree->count << " integers in the binary search tree." << endl;
+		start = cursor;
 		
-		// call Menu function
+		// saved integers are already committed - the memory limit must not
+		// drop them, or the next snapshot would lose them for good
 		
-		int exit = Menu (newTree);
+		limit = newTree->maxBytes;
+		newTree->maxBytes = 0;
+		
+		if (!ReadSnapshot (newTree, filename, start))
+		{
+			start = 0;
+		}
 		
-		// if user chooses to exit
-		// return 1 to main
+		OpenLog (newTree, filename, start);
 		
-		if (exit == 1)
+		if (newTree->log != NULL)
 		{
-			return 1;
+			start = newTree->log->textOffset;
 		}
-	}
-	
+		
+		newTree->maxBytes = limit;
+		used = FootprintBytes (newTree);
+		
+		if (limit > 0 && used > limit)
+		{
+			cout << endl;
+			cerr << "Warning - the saved integers use " << used << " bytes, more than the memory limit of "
+				 << limit << " bytes." << endl;
+		}
+	}
+	
+	// file is empty or has nothing new
+	
+	if (start >= cursor)
+	{
+		// Display total number of integers in binary search tree
+
+		cout << endl;
+		cout << "There are " << newTree->count << " integers in the binary search tree." << endl;
+		
+		return start;
+	}
+	
 	// file is not empty call ReadFiles function
+	// loaded text goes into a new snapshot, not one log record per integer
 	
-	if (cursor > 0)
+	log = newTree->log;
+	newTree->log = NULL;
+	loaded = ReadFiles (newTree, filename, opts, start);
+	newTree->log = log;
+	
+	// call CompactLog
+	
+	if (log != NULL)
 	{
-		int readFiles = ReadFiles (newTree, filename);
+		log->textOffset = loaded;
+		
+		if (!CompactLog (newTree, log))
+		{
+			cout << endl;
+			cerr << "Error - changes will not be saved." << endl;
+			
+			if (log->file != NULL)
+			{
+				fclose (log->file);
+			}
+			
+			delete log;
+			newTree->log = NULL;
+		}
 	}
+	
+	return loaded;
 }
 
 //*****************************************************************************
@@ -169,47 +1177,68 @@ int OpenFiles (binaryTree *newTree, string& filename)
 //  DESCRIPTION:  upon validation, reads text file data into binary tree
 //  INPUT:        Parameters:	newTree - pointer to new binary tree
 //								filename - data filename
-//  OUTPUT: 	  Return value: 1 - if user chooses to exit
-//  CALLS TO:	  Menu, InsertNode
+//								opts - command line options
+//								offset - file position to read from
+//  OUTPUT: 	  Return value: file position the tree is loaded up to
+//  CALLS TO:	  ResetParser, LoadFile, EndNumber, InsertBatch, DisplayMemory
 //*****************************************************************************
 
-int ReadFiles (binaryTree* newTree, string& filename)
+long long ReadFiles (binaryTree* newTree, string& filename, options& opts, long long offset)
 {
-	ifstream infile;	// for reading text file
-	int num;	// integer stored in text file
+	textParser parser;						// integers split across blocks
+	vector<int> batch;						// integers read from text file
+	loadStats stats;						// loader timings
+	long long loaded;						// bytes of text file parsed
 	
-	// text file is not empty re-open file
-	 
-	infile.open (filename.c_str());
+	// read and parse the text file
+	// call LoadFile
 	
-	// insert unique integers into binary tree
-	// call InsertNode
-		
-	while (infile >> num)
+	ResetParser (parser);
+	loaded = offset + LoadFile (newTree, filename, parser, batch, stats, opts.uring, offset);
+	
+	// the last integer may still be being written when following,
+	// leave it for the follow thread
+	
+	if (opts.follow)
 	{
-		InsertNode (newTree, num);
+		loaded -= parser.pendingBytes;
 	}
 	
-	// close text file
+	else if (parser.pendingBytes > 0 && !parser.failed)
+	{
+		EndNumber (parser, batch);
+	}
 	
-	infile.close();
+	// insert unique integers into binary tree
+	// call InsertBatch
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	InsertBatch (newTree, batch);
+	stats.cpu += chrono::duration<double> (chrono::steady_clock::now() - start).count();
+	
+	// display loader timings
+	
+	if (opts.loadTimes)
+	{
+		cout << endl;
+		cout << "Loaded " << stats.bytes << " bytes with " << stats.method << ": "
+			 << fixed << setprecision (1) << stats.ioWait * 1000 << " ms waiting on I/O, "
+			 << stats.cpu * 1000 << " ms parsing and inserting." << endl;
+		cout.unsetf (ios::floatfield);
+		cout.precision (6);
+	}
 	
 	// Display total number of integers in binary search tree
 	
 	cout << endl;
 	cout << "There are " << newTree->count << " integers in the binary search tree." << endl;
 	
-	// call Menu function
+	// call DisplayMemory
 	
-	int exit = Menu (newTree);
+	DisplayMemory (newTree);
 	
-	// if user chooses to exit 
-	// return 1 to main
-	
-	if (exit == 1)
-	{
-		return 1;
-	}
+	return loaded;
 }
 
 //*****************************************************************************
@@ -220,7 +1249,7 @@ int ReadFiles (binaryTree* newTree, string& filename)
 //				  3) Process Menu Choice
 //  INPUT:        Parameters:	newTree - pointer to new binary tree	
 //  OUTPUT: 	  Return value: 1 - if user chooses to exit
-//  CALLS TO:	  MenuSelect, ValidateSelect, ProcessSelect
+//  CALLS TO:	  MenuSelect, ValidateSelect, ProcessSelect, CommitLog
 //*****************************************************************************
 
 int Menu (binaryTree *newTree)
@@ -257,6 +1286,15 @@ int Menu (binaryTree *newTree)
 			if (valid)
 			{
 				ProcessSelect (newTree, choice);
+				
+				// changes made by this selection share one commit
+				
+				if (!CommitLog (newTree))
+				{
+					cout << endl;
+					cerr << "Error - unable to write " << newTree->log->logName
+						 << ", changes are kept and will be retried." << endl;
+				}
 			}
 		}
 	}
@@ -285,6 +1323,7 @@ void MenuSelect (char& selection)
 		cout << setw(41) << "D = Delete An Integer from the Tree" << endl;
 		cout << setw(44) << "P = Print Out All Integers in the Tree" << endl;
 		cout << setw(43) << "S = Search for an Integer in the Tree" << endl;
+		cout << setw(38) << "M = Show Memory Used by the Tree" << endl;
 		cout << setw(22) << "E = Exit Program" << endl;
 		
 		// prompt user for menu selection
@@ -316,11 +1355,11 @@ bool ValidateSelect (char& selection)
 	// invalid input - return false	
 	
 	if (!(selection == 'A' || selection == 'D' || selection == 'P'
-			|| selection == 'S' || selection == 'E'))
+			|| selection == 'S' || selection == 'M' || selection == 'E'))
 	{
 		cout << endl;
 		cerr << "Error - invalid input!" << endl; 
-		cerr << "Please enter an A, D, P, S, or E" << endl;
+		cerr << "Please enter an A, D, P, S, M, or E" << endl;
 		valid = false;
 	}
 	
@@ -359,14 +1398,18 @@ bool ValidateNum (int& num)
 //  INPUT:        Parameters:	newTree - pointer to new binary tree
 //								selection - menu selection
 //  OUTPUT: 	  Return value: none
-//  CALLS TO:	  InsertNode, FindNode, InOrderDisplay, DeleteNode, ValidateNum
+//  CALLS TO:	  InsertNode, FindNode, LookupNode, DeleteKey, InOrderDisplay,
+//				  ValidateNum, DisplayMemory
 //*******************************************************************************
 
 void ProcessSelect (binaryTree *newTree, char& selection)
 {
-	bool found;		// call to FindNode
+	bool found;		// call to FindNode or DeleteKey
+	node *located = NULL;	// call to LookupNode
 	bool valid;		// call to ValidateNum
 	int num;		// user inputted integer
+	unique_lock<shared_mutex> guard (newTree->lock, defer_lock);	// held around tree access,
+																	// never while prompting
 	
 	// Selection - A (Add node to binary tree)
 	
@@ -399,6 +1442,8 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		
 		if (valid)
 		{
+			guard.lock();
+			
 			// call InsertNode
 			
 			InsertNode (newTree, num);
@@ -417,13 +1462,17 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		// call IsEmpty
 		// root is NULL - return to menu
 		
-		if (IsEmpty(newTree->root))
+		guard.lock();
+		
+		if (IsEmpty(newTree))
 		{
 			cout << endl;
 			cerr << "Cannot delete from an empty binary tree!" << endl;
 			return;
 		}
 		
+		guard.unlock();
+		
 		// prompt user for integer to delete
 		
 		cout << endl;
@@ -451,9 +1500,11 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		
 		if (valid)
 		{
-			// call FindNode
+			guard.lock();
 			
-			found = FindNode (newTree, num);
+			// call DeleteKey
+			
+			found = DeleteKey (newTree, num);
 			
 			// integer was not found - return to menu
 			
@@ -464,10 +1515,6 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 				return;
 			}
 			
-			// call DeleteNode
-			
-			DeleteNode (newTree);
-			
 			// Display total number of integers in binary search tree
 	
 			cout << endl;
@@ -482,7 +1529,9 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		// call IsEmpty
 		// root is NULL - return to menu
 		
-		if (IsEmpty(newTree->root))
+		guard.lock();
+		
+		if (IsEmpty(newTree))
 		{
 			cout << endl;
 			cerr << "Binary search tree is empty." << endl;
@@ -492,9 +1541,18 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		cout << endl;
 		cout << "Values stored in binary search tree are:" << endl;
 		
-		// call InOrderDisplay
+		// call SetDisplay or InOrderDisplay
+		
+		if (newTree->set != NULL)
+		{
+			SetDisplay (newTree->set);
+		}
+		
+		else
+		{
+			InOrderDisplay (newTree->root);
+		}
 		
-		InOrderDisplay (newTree->root);
 		cout << endl;
 	}
 	
@@ -505,13 +1563,17 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		// call IsEmpty
 		// root is NULL - return to menu
 		
-		if (IsEmpty(newTree->root))
+		guard.lock();
+		
+		if (IsEmpty(newTree))
 		{
 			cout << endl;
 			cerr << "Cannot search an empty tree." << endl;
 			return;
 		}
 		
+		guard.unlock();
+		
 		// prompt user for integer to find
 		
 		cout << endl;
@@ -539,9 +1601,30 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 		
 		if (valid)
 		{
+			guard.lock();
+			
+			// compressed mode has no subtree to display
 			// call FindNode
 			
-			found = FindNode (newTree, num);
+			if (newTree->set != NULL)
+			{
+				found = FindNode (newTree, num);
+				
+				if (found)
+				{
+					cout << endl;
+					cout << num << " is stored in the compressed integer set." << endl;
+					return;
+				}
+			}
+			
+			// call LookupNode
+			
+			else
+			{
+				located = LookupNode (newTree, num);
+				found = (located != NULL);
+			}
 			
 			// integer was not found - return to menu
 			
@@ -552,16 +1635,48 @@ void ProcessSelect (binaryTree *newTree, char& selection)
 				return;
 			}
 			
-			// display subtree
+			// display subtree of the located node
+			// missing children are shown as '-'
 			
 			cout << endl;
 			cout << "Values stored in subtree with root " << num << " are:" << endl;
-		
-			cout << setw(6) << newTree->root->left->num
-			     << setw(6) << num << setw(6) << newTree->root->right->num;
+			
+			if (located->left != NULL)
+			{
+				cout << setw(6) << located->left->num;
+			}
+			
+			else
+			{
+				cout << setw(6) << "-";
+			}
+			
+			cout << setw(6) << num;
+			
+			if (located->right != NULL)
+			{
+				cout << setw(6) << located->right->num;
+			}
+			
+			else
+			{
+				cout << setw(6) << "-";
+			}
+			
 			cout << endl;
 		}
-	}		
+	}
+	
+	// Selection - M (Display memory used by binary tree)
+	
+	else if (selection == 'M')
+	{
+		guard.lock();
+		
+		// call DisplayMemory
+		
+		DisplayMemory (newTree);
+	}
 }
 
 //*****************************************************************************
@@ -584,338 +1699,5636 @@ binaryTree* CreateTree()
 		cerr << "ERROR -- Unable to allocate memory for binary search tree!" << endl;
 	}
 	
-	// set count to zero and root pointer to NULL
+	// set count to zero and root, set and log pointers to NULL
 	
 	else
 	{
 		newTree->count = 0;
 		newTree->root = NULL;
+		newTree->set = NULL;
+		newTree->log = NULL;
+		newTree->quiet = false;
+		newTree->cache = NULL;
+		newTree->maxBytes = 0;
+		newTree->roomLeft = 0;
+		newTree->compactOnLimit = false;
+	}
+	
+	return newTree;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  IsEmpty
+//  DESCRIPTION:  determines whether the tree is empty or not
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//  OUTPUT: 	  Return value: empty - true (if tree is empty)
+//								   	    false (if tree is not empty)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool IsEmpty (binaryTree* newTree)
+{
+	bool empty = true;
+	
+	// root is not NULL or set is not empty - return false
+	
+	if (newTree->root != NULL || newTree->count > 0)
+	{
+		empty = false;
+	}
+	
+	return empty;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CreateNode
+//  DESCRIPTION:  allocates and fills a new node
+//  INPUT:        Parameters:	num - integer value
+//  OUTPUT: 	  Return value: newNode - pointer to new node
+//								NULL - memory allocation failure
+//  CALLS TO:	  none
+//*****************************************************************************
+
+node* CreateNode (int num)
+{
+	node *newNode = new (nothrow) node;	// pointer to new node
+	
+	// memory allocation failure
+	
+	if (newNode == NULL)
+	{
+		cout << endl;
+		cerr << "ERROR - memory allocation failure!" << endl;
+		return NULL;
+	}
+	
+	// fill new node
+	
+	newNode->num = num;
+	newNode->left = NULL;
+	newNode->right = NULL;
+	
+	return (newNode);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  InsertNode
+//  DESCRIPTION:  inserts a new node into the tree
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								insertNum - integer being added	to tree
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  BudgetRoom, CreateNode, SetInsertLimit, LogRecord
+//*****************************************************************************
+
+void InsertNode (binaryTree *newTree, int insertNum)
+{
+	node* current;	// pointer to current node
+	node* parent;	// pointer to parent node
+	node* newNode;	// pointer to new node
+	int added = 1;	// compressed set: 1 - added, 0 - duplicate, -1 - no room
+	
+	// call BudgetRoom
+	// compressed mode - call SetInsertLimit
+	
+	if (BudgetRoom (newTree, 1) == 0)
+	{
+		added = -1;
+	}
+	
+	else if (newTree->set != NULL)
+	{
+		added = SetInsertLimit (newTree, insertNum);
+	}
+	
+	// memory limit reached
+	
+	if (added < 0)
+	{
+		if (!newTree->quiet)
+		{
+			cout << endl;
+			cerr << insertNum << " was not added, the memory limit of ";
+			cerr << newTree->maxBytes << " bytes is reached." << endl;
+		}
+		
+		return;
+	}
+	
+	if (newTree->set != NULL)
+	{
+		if (added > 0)
+		{
+			newTree->count++;
+			LogRecord (newTree, 'A', insertNum);
+		}
+		
+		else if (!newTree->quiet)
+		{
+			cout << endl;
+			cerr << insertNum << " is already in the list ";
+			cerr << "duplicates are not allowed." << endl;
+		}
+		
+		return;
+	}
+	
+	// call CreateNode
+	
+	newNode = CreateNode (insertNum);
+	
+	if (newNode == NULL)
+	{
+		return;
+	}
+	
+	// empty binary tree
+	// add new node
+	
+	if (newTree->root == NULL)
+	{
+		newTree->root = newNode;
+		newTree->count++;
+	}
+	
+	else
+	{
+		// traverse tree until appropriate
+		// leaf position is found
+		
+		current = newTree->root;
+		newTree->count++;
+		
+		while (current != NULL)
+		{
+			parent = current;
+			
+			// duplicate is found
+			
+			if (current->num == insertNum)
+			{
+				if (!newTree->quiet)
+				{
+					cout << endl;
+					cerr << insertNum << " is already in the list ";
+					cerr << "duplicates are not allowed." << endl;
+				}
+				
+				newTree->count--;
+				delete newNode;
+				return;	
+			}
+			
+			else if (current->num > insertNum)
+			{
+				current = current->left;
+			}
+			
+			else
+			{
+				current = current->right;
+			}
+		}
+		
+		// link the new child to its parent
+		
+		if (parent->num > insertNum)
+		{
+			parent->left = newNode;
+		}
+		
+		else
+		{
+			parent->right = newNode;
+		}
+	}
+	
+	// call LogRecord
+	
+	LogRecord (newTree, 'A', insertNum);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FindNode
+//  DESCRIPTION:  searches for a value in the tree
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								searchNum - integer being searched for
+//  OUTPUT: 	  Return value: found - true (if integer is found)
+//									  - false (if integer is not found)
+//  CALLS TO:	  SetFind, LookupNode
+//*****************************************************************************
+
+bool FindNode (binaryTree *newTree, int searchNum)
+{
+	bool found = false;	// integer found or not found 
+	
+	// compressed mode - call SetFind
+	
+	if (newTree->set != NULL)
+	{
+		return SetFind (newTree->set, searchNum);
+	}
+	
+	// Error message displays if binary tree is empty
+	
+	if (newTree->root == NULL)
+	{
+		if (!newTree->quiet)
+		{
+			cout << endl;
+			cerr << "Cannot search an empty tree." << endl;
+		}
+	}
+	
+	// call LookupNode
+	
+	else
+	{
+		found = (LookupNode (newTree, searchNum) != NULL);
+	}
+	
+	return found;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LocateNode
+//  DESCRIPTION:  searches for a value in the tree, keeping track of the
+//				  parent and the link leading to it
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								searchNum - integer being searched for
+//  OUTPUT: 	  Return value: handle - found node, its parent and its link
+//								(found is NULL if integer is not found)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+nodeHandle LocateNode (binaryTree *newTree, int searchNum)
+{
+	nodeHandle handle;		// search result
+	
+	handle.parent = NULL;
+	handle.link = &newTree->root;
+	
+	while (*handle.link != NULL && (*handle.link)->num != searchNum)
+	{
+		handle.parent = *handle.link;
+		
+		// traverse left
+		
+		if (handle.parent->num > searchNum)
+		{
+			handle.link = &handle.parent->left;
+		}
+		
+		// traverse right
+		
+		else
+		{
+			handle.link = &handle.parent->right;
+		}
+	}
+	
+	handle.found = *handle.link;
+	
+	return handle;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DeleteKey
+//  DESCRIPTION:  finds and deletes a value in a single descent
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								deleteNum - integer being deleted
+//  OUTPUT: 	  Return value: true (if deleted) / false (if not found)
+//  CALLS TO:	  SetDelete, LogRecord, LocateNode, DeleteNode
+//*****************************************************************************
+
+bool DeleteKey (binaryTree *newTree, int deleteNum)
+{
+	nodeHandle handle;		// call to LocateNode
+	
+	// compressed mode - call SetDelete
+	
+	if (newTree->set != NULL)
+	{
+		if (!SetDelete (newTree->set, deleteNum))
+		{
+			return false;
+		}
+		
+		newTree->count--;
+		LogRecord (newTree, 'D', deleteNum);
+		
+		return true;
+	}
+	
+	// call LocateNode
+	
+	handle = LocateNode (newTree, deleteNum);
+	
+	if (handle.found == NULL)
+	{
+		return false;
+	}
+	
+	// call DeleteNode with the located handle
+	
+	DeleteNode (newTree, handle);
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DeleteNode
+//  DESCRIPTION:  deletes a located node from the tree
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								handle - node located by LocateNode
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  RemoveNode
+//*****************************************************************************
+
+void DeleteNode (binaryTree* newTree, nodeHandle& handle)
+{
+	// error messages displays - node is NULL
+	
+	if (handle.found == NULL)
+	{
+		cout << endl;
+		cerr << "Error: The node to be deleted is NULL." << endl;
+		return;
+	}
+	
+	// call RemoveNode on the link holding the node
+	
+	RemoveNode (newTree, *handle.link);
+	handle.found = NULL;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CreateCache
+//  DESCRIPTION:  allocates an empty hot-key cache
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: cache - pointer to new hot-key cache
+//  CALLS TO:	  ClearCache
+//*****************************************************************************
+
+hotCache* CreateCache()
+{
+	hotCache *cache = new hotCache;		// pointer to new hot-key cache
+	
+	ClearCache (cache);
+	
+	return cache;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ClearCache
+//  DESCRIPTION:  empties every slot of the hot-key cache
+//  INPUT:        Parameters:	cache - pointer to hot-key cache
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void ClearCache (hotCache *cache)
+{
+	for (int i = 0; i < HOT_CACHE_SLOTS; i++)
+	{
+		cache->slots[i].num = 0;
+		cache->slots[i].found = NULL;
+	}
+	
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CacheSlot
+//  DESCRIPTION:  maps an integer to its hot-key cache slot
+//  INPUT:        Parameters:	num - integer being cached
+//  OUTPUT: 	  Return value: slot index
+//  CALLS TO:	  none
+//*****************************************************************************
+
+int CacheSlot (int num)
+{
+	// multiplicative hash - spreads clustered integers across slots
+	
+	return (uint32_t(num) * 2654435761u) >> (32 - HOT_CACHE_BITS);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LookupNode
+//  DESCRIPTION:  searches for a value, checking the hot-key cache before
+//				  descending the tree; found nodes are cached
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								searchNum - integer being searched for
+//  OUTPUT: 	  Return value: pointer to matching node
+//								NULL - integer is not found
+//  CALLS TO:	  CacheSlot, LocateNode
+//*****************************************************************************
+
+node* LookupNode (binaryTree *newTree, int searchNum)
+{
+	hotCache *cache = newTree->cache;	// hot-key cache
+	node *found;						// matching node
+	
+	// cache is not enabled - call LocateNode
+	
+	if (cache == NULL)
+	{
+		return LocateNode (newTree, searchNum).found;
+	}
+	
+	hotSlot& slot = cache->slots[CacheSlot (searchNum)];
+	
+	// cache hit
+	
+	if (slot.found != NULL && slot.num == searchNum)
+	{
+		cache->hits++;
+		return slot.found;
+	}
+	
+	// cache miss - call LocateNode and keep the result
+	
+	cache->misses++;
+	found = LocateNode (newTree, searchNum).found;
+	
+	if (found != NULL)
+	{
+		slot.num = searchNum;
+		slot.found = found;
+	}
+	
+	return found;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  InvalidateCache
+//  DESCRIPTION:  drops an integer from the hot-key cache
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								num - integer whose node is changing
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  CacheSlot
+//*****************************************************************************
+
+void InvalidateCache (binaryTree *newTree, int num)
+{
+	if (newTree->cache == NULL)
+	{
+		return;
+	}
+	
+	hotSlot& slot = newTree->cache->slots[CacheSlot (num)];
+	
+	if (slot.num == num)
+	{
+		slot.found = NULL;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BenchHotKeys
+//  DESCRIPTION:  times lookups on a skewed (Zipfian) and a uniform workload,
+//				  with and without the hot-key cache
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  CreateTree, InsertBatch, FindNode, CreateCache, ClearCache,
+//				  DestroyTree
+//*****************************************************************************
+
+void BenchHotKeys()
+{
+	mt19937 random (12345);						// fixed seed, repeatable runs
+	vector<int> keys (BENCH_KEYS);				// integers in the tree
+	vector<int> batch;							// copy consumed by InsertBatch
+	vector<double> weights (BENCH_KEYS);		// Zipf cumulative weights
+	vector<int> queries (BENCH_LOOKUPS);		// lookup sequence
+	binaryTree *benchTree = CreateTree();		// tree being measured
+	hotCache *cache = CreateCache();			// cache attached for cached runs
+	double total = 0;							// running weight total
+	long long found;							// lookups that hit (kept live)
+	double nanos;								// time per lookup
+	
+	// distinct positive keys in random order
+	// rank r of the Zipf distribution maps to keys[r]
+	
+	for (int i = 0; i < BENCH_KEYS; i++)
+	{
+		keys[i] = 2 * i + 1;
+	}
+	
+	shuffle (keys.begin(), keys.end(), random);
+	batch = keys;
+	benchTree->quiet = true;
+	InsertBatch (benchTree, batch);
+	
+	for (int i = 0; i < BENCH_KEYS; i++)
+	{
+		total += 1.0 / pow (i + 1.0, ZIPF_EXPONENT);
+		weights[i] = total;
+	}
+	
+	cout << "Hot-key benchmark: " << BENCH_KEYS << " integers, "
+		 << BENCH_LOOKUPS << " lookups, Zipf exponent " << ZIPF_EXPONENT << endl << endl;
+	cout << left << setw(10) << "workload" << setw(10) << "mode"
+		 << right << setw(14) << "ns/lookup" << setw(12) << "hit rate" << endl;
+	
+	for (int workload = 0; workload < 2; workload++)
+	{
+		// build the lookup sequence before timing
+		
+		for (int i = 0; i < BENCH_LOOKUPS; i++)
+		{
+			if (workload == 0)
+			{
+				double pick = uniform_real_distribution<double> (0, total) (random);
+				queries[i] = keys[lower_bound (weights.begin(), weights.end(), pick) - weights.begin()];
+			}
+			
+			else
+			{
+				queries[i] = keys[random() % BENCH_KEYS];
+			}
+		}
+		
+		for (int mode = 0; mode < 2; mode++)
+		{
+			ClearCache (cache);
+			benchTree->cache = (mode == 0) ? NULL : cache;
+			found = 0;
+			
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			
+			for (int i = 0; i < BENCH_LOOKUPS; i++)
+			{
+				found += FindNode (benchTree, queries[i]);
+			}
+			
+			nanos = chrono::duration<double, nano> (chrono::steady_clock::now() - start).count()
+					/ BENCH_LOOKUPS;
+			
+			cout << left << setw(10) << (workload == 0 ? "zipf" : "uniform")
+				 << setw(10) << (mode == 0 ? "static" : "cached")
+				 << right << fixed << setprecision(1) << setw(14) << nanos;
+			
+			if (mode == 0)
+			{
+				cout << setw(12) << "-";
+			}
+			
+			else
+			{
+				cout << setw(11) << 100.0 * cache->hits / BENCH_LOOKUPS << "%";
+			}
+			
+			cout << (found == BENCH_LOOKUPS ? "" : "  (lookup failed)") << endl;
+		}
+	}
+	
+	benchTree->cache = NULL;
+	DestroyTree (benchTree);
+	delete cache;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BuildIndex
+//  DESCRIPTION:  builds a read-only learned index over the integers in the
+//				  tree; the sorted integers are split into linear segments
+//				  that predict a position within INDEX_ERROR (shrinking
+//				  cone), and a radix table over integer prefixes selects the
+//				  segment; the index does not follow later tree changes,
+//				  so only BenchIndex builds one
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//  OUTPUT: 	  Return value: pointer to the new index
+//  CALLS TO:	  CollectKeys
+//*****************************************************************************
+
+learnedIndex* BuildIndex (binaryTree *newTree)
+{
+	learnedIndex *index = new learnedIndex;		// index being built
+	indexSegment segment;						// segment being fitted
+	double low;									// smallest slope keeping all points
+	double high;								// largest slope keeping all points
+	double dx;									// distance from the segment's first key
+	long long range;							// largest key minus smallest key
+	int bits = 1;								// radix table prefix bits
+	int end;									// position after the segment
+	int n;										// number of integers
+	
+	CollectKeys (newTree, index->keys);
+	n = index->keys.size();
+	
+	// fit segments left to right, narrowing the cone of slopes
+	// until the next point no longer fits
+	
+	for (int start = 0; start < n; start = end)
+	{
+		segment.firstKey = index->keys[start];
+		segment.start = start;
+		low = -HUGE_VAL;
+		high = HUGE_VAL;
+		
+		for (end = start + 1; end < n; end++)
+		{
+			dx = (double)index->keys[end] - segment.firstKey;
+			
+			if (max (low, (end - start - INDEX_ERROR) / dx)
+				> min (high, (end - start + INDEX_ERROR) / dx))
+			{
+				break;
+			}
+			
+			low = max (low, (end - start - INDEX_ERROR) / dx);
+			high = min (high, (end - start + INDEX_ERROR) / dx);
+		}
+		
+		segment.slope = (end - start == 1) ? 0 : (low + high) / 2;
+		index->segments.push_back (segment);
+	}
+	
+	// about two table entries per segment, up to INDEX_RADIX_BITS
+	
+	while (bits < INDEX_RADIX_BITS && (1u << bits) < 2 * index->segments.size())
+	{
+		bits++;
+	}
+	
+	index->minKey = (n == 0) ? 0 : index->keys[0];
+	range = (n == 0) ? 0 : (long long)index->keys[n - 1] - index->minKey;
+	index->shift = 0;
+	
+	while ((range >> index->shift) >= (1LL << bits))
+	{
+		index->shift++;
+	}
+	
+	// radix[p] - first segment whose first key has prefix p or higher
+	
+	index->radix.resize ((1 << bits) + 1);
+	end = 0;
+	
+	for (int p = 0; p <= (1 << bits); p++)
+	{
+		while (end < (int)index->segments.size()
+			   && (((long long)index->segments[end].firstKey - index->minKey) >> index->shift) < p)
+		{
+			end++;
+		}
+		
+		index->radix[p] = end;
+	}
+	
+	return index;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  IndexFind
+//  DESCRIPTION:  searches for a value in the learned index; the radix table
+//				  and segment are small and usually cached, leaving the
+//				  search of the predicted window of integers
+//  INPUT:        Parameters:	index - learned index
+//								searchNum - integer being searched for
+//  OUTPUT: 	  Return value: true (integer found) / false (not found)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool IndexFind (learnedIndex *index, int searchNum)
+{
+	const vector<int>& keys = index->keys;			// frozen sorted integers
+	const vector<indexSegment>& segments = index->segments;
+	long long prefix;								// radix table entry
+	long long predicted;							// predicted position
+	int first;										// first candidate segment
+	int last;										// end of candidate segments
+	int s;											// segment holding the integer
+	int low;										// start of the search window
+	int high;										// end of the search window
+	
+	if (keys.empty() || searchNum < keys.front() || searchNum > keys.back())
+	{
+		return false;
+	}
+	
+	// the segment is the last one starting at or before the integer
+	
+	prefix = ((long long)searchNum - index->minKey) >> index->shift;
+	first = max (index->radix[prefix] - 1, 0);
+	last = index->radix[prefix + 1];
+	
+	while (first + 1 < last)
+	{
+		s = (first + last) / 2;
+		
+		if (segments[s].firstKey <= searchNum)
+		{
+			first = s;
+		}
+		
+		else
+		{
+			last = s;
+		}
+	}
+	
+	s = first;
+	
+	// search the window around the predicted position, kept inside the
+	// segment (integers in the gap after a segment extrapolate past it)
+	
+	low = segments[s].start;
+	high = (s + 1 < (int)segments.size()) ? segments[s + 1].start : keys.size();
+	predicted = low + llround (segments[s].slope * ((double)searchNum - segments[s].firstKey));
+	predicted = min<long long> (max<long long> (predicted, low), high - 1);
+	low = max<long long> (predicted - INDEX_ERROR - 1, low);
+	high = min<long long> (predicted + INDEX_ERROR + 2, high);
+	
+	return binary_search (keys.begin() + low, keys.begin() + high, searchNum);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BenchIndex
+//  DESCRIPTION:  times membership lookups in the pointer tree, binary search
+//				  over the sorted integers and the learned index, on uniform
+//				  and lognormal integers
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  CreateTree, InsertBatch, BuildIndex, FindNode, IndexFind,
+//				  DestroyTree
+//*****************************************************************************
+
+void BenchIndex()
+{
+	mt19937 random (12345);						// fixed seed, repeatable runs
+	vector<int> keys;							// integers in the tree
+	vector<int> batch;							// copy consumed by InsertBatch
+	vector<int> queries (BENCH_LOOKUPS);		// lookup sequence
+	binaryTree *benchTree;						// tree being measured
+	learnedIndex *index;						// index built from the tree
+	long long found[3];							// lookups that hit (kept live)
+	double nanos;								// time per lookup
+	
+	cout << "Index benchmark: about " << BENCH_KEYS << " integers, "
+		 << BENCH_LOOKUPS << " lookups (half present)" << endl << endl;
+	cout << left << setw(12) << "keys" << setw(16) << "method"
+		 << right << setw(14) << "ns/lookup" << setw(14) << "bytes/key" << endl;
+	
+	for (int workload = 0; workload < 2; workload++)
+	{
+		// distinct integers in random order
+		
+		keys.clear();
+		
+		for (int i = 0; i < BENCH_KEYS; i++)
+		{
+			if (workload == 0)
+			{
+				keys.push_back (random() & INT_MAX);
+			}
+			
+			else
+			{
+				keys.push_back (int(min ((double)INT_MAX, 1e6 * lognormal_distribution<double> (0, 2) (random))));
+			}
+		}
+		
+		sort (keys.begin(), keys.end());
+		keys.erase (unique (keys.begin(), keys.end()), keys.end());
+		
+		// half present integers, half anywhere in the integers' range
+		
+		for (int i = 0; i < BENCH_LOOKUPS; i++)
+		{
+			queries[i] = (i % 2 == 0) ? keys[random() % keys.size()]
+						 : uniform_int_distribution<int> (keys.front(), keys.back()) (random);
+		}
+		
+		batch = keys;
+		shuffle (batch.begin(), batch.end(), random);
+		benchTree = CreateTree();
+		benchTree->quiet = true;
+		InsertBatch (benchTree, batch);
+		index = BuildIndex (benchTree);
+		
+		for (int method = 0; method < 3; method++)
+		{
+			found[method] = 0;
+			
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			
+			for (int i = 0; i < BENCH_LOOKUPS; i++)
+			{
+				if (method == 0)
+				{
+					found[method] += FindNode (benchTree, queries[i]);
+				}
+				
+				else if (method == 1)
+				{
+					found[method] += binary_search (keys.begin(), keys.end(), queries[i]);
+				}
+				
+				else
+				{
+					found[method] += IndexFind (index, queries[i]);
+				}
+			}
+			
+			nanos = chrono::duration<double, nano> (chrono::steady_clock::now() - start).count()
+					/ BENCH_LOOKUPS;
+			
+			cout << left << setw(12) << (workload == 0 ? "uniform" : "lognormal")
+				 << setw(16) << (method == 0 ? "tree" : method == 1 ? "binary search" : "learned index")
+				 << right << fixed << setprecision(1) << setw(14) << nanos << setw(14)
+				 << (method == 0 ? (double)sizeof (node)
+					 : method == 1 ? (double)sizeof (int)
+					 : (double)(index->keys.size() * sizeof (int)
+								+ index->segments.size() * sizeof (indexSegment)
+								+ index->radix.size() * sizeof (int)) / keys.size())
+				 << (found[method] == found[0] ? "" : "  (lookup failed)") << endl;
+		}
+		
+		cout << setw(12) << "" << index->segments.size() << " segments, error "
+			 << INDEX_ERROR << ", " << keys.size() << " integers" << endl;
+		
+		delete index;
+		DestroyTree (benchTree);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BenchGeneric
+//  DESCRIPTION:  times inserts, lookups and deletes in the int tree and in
+//				  BinaryTree<int, int> on the same random integers, checks
+//				  that both hold the same integers, and exercises the
+//				  generic tree with move-only keys and values
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  CreateTree, InsertNode, FindNode, DeleteKey, CollectKeys,
+//				  DestroyTree
+//*****************************************************************************
+
+void BenchGeneric()
+{
+	mt19937 random (12345);						// fixed seed, repeatable runs
+	vector<int> keys (BENCH_KEYS);				// integers inserted
+	vector<int> queries (BENCH_LOOKUPS);		// lookup sequence
+	vector<int> intKeys;						// int tree contents
+	vector<int> genericKeys;					// generic tree contents
+	binaryTree *intTree = CreateTree();			// int tree being measured
+	BinaryTree<int, int> genericTree;			// generic tree being measured
+	long long found[2] = {0, 0};				// lookups that hit
+	double nanos[2][3];							// time per insert, lookup, delete
+	bool match;									// both trees agree
+	
+	// random integers, lookups half present
+	
+	for (int i = 0; i < BENCH_KEYS; i++)
+	{
+		keys[i] = random() & INT_MAX;
+	}
+	
+	for (int i = 0; i < BENCH_LOOKUPS; i++)
+	{
+		queries[i] = (i % 2 == 0) ? keys[random() % BENCH_KEYS] : int(random() & INT_MAX);
+	}
+	
+	intTree->quiet = true;
+	
+	// both trees run each phase before the next phase starts, so neither
+	// inserts into nodes the other tree's deletes just freed
+	
+	for (int phase = 0; phase < 3; phase++)
+	{
+		for (int tree = 0; tree < 2; tree++)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			int operations = (phase == 1) ? BENCH_LOOKUPS : BENCH_KEYS;
+			
+			for (int i = 0; i < operations; i++)
+			{
+				if (phase == 0 && tree == 0)
+				{
+					InsertNode (intTree, keys[i]);
+				}
+				
+				else if (phase == 0)
+				{
+					genericTree.Emplace (keys[i], keys[i]);
+				}
+				
+				else if (phase == 1 && tree == 0)
+				{
+					found[0] += FindNode (intTree, queries[i]);
+				}
+				
+				else if (phase == 1)
+				{
+					found[1] += (genericTree.Find (queries[i]) != NULL);
+				}
+				
+				else if (tree == 0)
+				{
+					DeleteKey (intTree, keys[i]);
+				}
+				
+				else
+				{
+					genericTree.Delete (keys[i]);
+				}
+			}
+			
+			nanos[tree][phase] = chrono::duration<double, nano> (chrono::steady_clock::now() - start).count()
+								 / operations;
+			
+			// compare contents once both trees are loaded
+			
+			if (phase == 0 && tree == 0)
+			{
+				CollectKeys (intTree, intKeys);
+			}
+			
+			else if (phase == 0)
+			{
+				genericTree.InOrder ([&] (const int& key, const int&) { genericKeys.push_back (key); });
+			}
+		}
+	}
+	
+	// move-only keys and values, and a comparator object
+	
+	{
+		struct lessPointee
+		{
+			bool operator() (const unique_ptr<int>& a, const unique_ptr<int>& b) const
+			{
+				return *a < *b;
+			}
+		};
+		
+		BinaryTree<unique_ptr<int>, unique_ptr<int>, lessPointee> owned;	// move-only entries
+		BinaryTree<unique_ptr<int>, unique_ptr<int>, lessPointee> moved;	// move target
+		int sum = 0;														// values visited
+		
+		for (int i = 0; i < 100; i++)
+		{
+			owned.Emplace (unique_ptr<int> (new int (i)), unique_ptr<int> (new int (2 * i)));
+		}
+		
+		owned.Delete (unique_ptr<int> (new int (50)));
+		moved = std::move (owned);
+		moved.InOrder ([&] (const unique_ptr<int>&, const unique_ptr<int>& value) { sum += *value; });
+		match = (moved.Count() == 99 && owned.IsEmpty() && sum == 9900 - 100);
+	}
+	
+	match = match && intKeys == genericKeys && found[0] == found[1]
+			&& intTree->count == 0 && genericTree.IsEmpty();
+	
+	cout << "Generic tree benchmark: " << BENCH_KEYS << " random integers, "
+		 << BENCH_LOOKUPS << " lookups (half present)" << endl << endl;
+	cout << left << setw(22) << "tree" << right << setw(14) << "insert ns"
+		 << setw(14) << "lookup ns" << setw(14) << "delete ns" << endl;
+	
+	for (int tree = 0; tree < 2; tree++)
+	{
+		cout << left << setw(22) << (tree == 0 ? "int tree" : "BinaryTree<int, int>")
+			 << right << fixed << setprecision(1) << setw(14) << nanos[tree][0]
+			 << setw(14) << nanos[tree][1] << setw(14) << nanos[tree][2] << endl;
+	}
+	
+	cout << endl << (match ? "Both trees held the same integers."
+						   : "Error - the trees disagree!") << endl;
+	
+	DestroyTree (intTree);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  InsertBatch
+//  DESCRIPTION:  inserts a batch of integers in one merged traversal; the
+//				  batch is sorted so keys sharing a descent path are routed
+//				  together, and duplicates are rejected before allocation;
+//				  the caller commits the logged changes
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								batch - integers being added to tree (sorted
+//										in place)
+//  OUTPUT: 	  Return value: number of integers added to the tree
+//  CALLS TO:	  BudgetRoom, InsertRun, SetInsertLimit, LogRecord,
+//				  SetOptimizeKey
+//*****************************************************************************
+
+int InsertBatch (binaryTree *newTree, vector<int>& batch)
+{
+	int before = newTree->count;	// count before the batch is applied
+	int unique = 0;					// number of distinct integers in batch
+	int fit;						// distinct integers within the memory limit
+	int refused = 0;				// integers refused at the memory limit
+	int added;						// compressed set: 1 - added, 0 - duplicate,
+									// -1 - no room
+	
+	// sort the batch
+	
+	sort (batch.begin(), batch.end());
+	
+	// reject duplicates within the batch itself
+	
+	for (int i = 0; i < (int)batch.size(); i++)
+	{
+		if (unique > 0 && batch[unique - 1] == batch[i])
+		{
+			if (!newTree->quiet)
+			{
+				cout << endl;
+				cerr << batch[i] << " is already in the list ";
+				cerr << "duplicates are not allowed." << endl;
+			}
+		}
+		
+		else
+		{
+			batch[unique++] = batch[i];
+		}
+	}
+	
+	// memory limit - keep the smallest integers that fit
+	// call BudgetRoom (the compressed set is budgeted per integer below)
+	
+	fit = BudgetRoom (newTree, unique);
+	refused = unique - fit;
+	unique = fit;
+	batch.resize (unique);
+	
+	// compressed mode - sorted keys fill one container at a time
+	// call SetInsertLimit, then SetOptimizeKey once the batch leaves a container
+	
+	if (newTree->set != NULL)
+	{
+		for (int i = 0; i < unique; i++)
+		{
+			added = SetInsertLimit (newTree, batch[i]);
+			
+			if (added > 0)
+			{
+				newTree->count++;
+				LogRecord (newTree, 'A', batch[i]);
+			}
+			
+			else if (added < 0)
+			{
+				refused++;
+			}
+			
+			else if (!newTree->quiet)
+			{
+				cout << endl;
+				cerr << batch[i] << " is already in the list ";
+				cerr << "duplicates are not allowed." << endl;
+			}
+			
+			if (i + 1 == unique || uint32_t(batch[i + 1] ^ batch[i]) >> 16 != 0)
+			{
+				SetOptimizeKey (newTree->set, batch[i]);
+			}
+		}
+	}
+	
+	// call InsertRun from the root
+	
+	else if (unique > 0)
+	{
+		InsertRun (newTree, newTree->root, &batch[0], 0, unique);
+	}
+	
+	if (refused > 0 && !newTree->quiet)
+	{
+		cout << endl;
+		cerr << refused << " integers were not added, the memory limit of ";
+		cerr << newTree->maxBytes << " bytes is reached." << endl;
+	}
+	
+	return newTree->count - before;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  InsertRun
+//  DESCRIPTION:  merges a sorted run of unique integers into a subtree;
+//				  pending runs are split around each node and kept on a
+//				  runTask stack instead of recursing
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								link - pointer to the subtree root
+//								keys - sorted integers being added
+//								first - index of first integer in run
+//								last - index one past the last integer in run
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  BuildSubtree
+//*****************************************************************************
+
+void InsertRun (binaryTree *newTree, node*& link, const int* keys, int first, int last)
+{
+	vector<runTask> pending;	// runs still to be merged
+	runTask task;				// run being merged
+	int split;					// first integer not less than the node
+	
+	pending.push_back (runTask {&link, first, last, false});
+	
+	while (!pending.empty())
+	{
+		task = pending.back();
+		pending.pop_back();
+		
+		// duplicate marker - report keys[first] in order
+		
+		if (task.link == NULL)
+		{
+			if (!newTree->quiet)
+			{
+				cout << endl;
+				cerr << keys[task.first] << " is already in the list ";
+				cerr << "duplicates are not allowed." << endl;
+			}
+			
+			continue;
+		}
+		
+		// empty run - nothing to add
+		
+		if (task.first >= task.last)
+		{
+			continue;
+		}
+		
+		// empty subtree
+		// the whole run fits here, call BuildSubtree
+		
+		if (*task.link == NULL)
+		{
+			*task.link = BuildSubtree (newTree, keys, task.first, task.last);
+			continue;
+		}
+		
+		// split the run around the current node
+		// the left run is pushed last so it is merged first
+		
+		split = lower_bound (keys + task.first, keys + task.last, (*task.link)->num) - keys;
+		
+		if (split < task.last && keys[split] == (*task.link)->num)
+		{
+			pending.push_back (runTask {&(*task.link)->right, split + 1, task.last, false});
+			pending.push_back (runTask {NULL, split, split + 1, false});
+		}
+		
+		else
+		{
+			pending.push_back (runTask {&(*task.link)->right, split, task.last, false});
+		}
+		
+		pending.push_back (runTask {&(*task.link)->left, task.first, split, false});
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BuildSubtree
+//  DESCRIPTION:  builds a balanced subtree from a sorted run of integers;
+//				  recursion depth is log2 of the run length
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								keys - sorted integers being added
+//								first - index of first integer in run
+//								last - index one past the last integer in run
+//  OUTPUT: 	  Return value: pointer to subtree root
+//								NULL - empty run or allocation failure
+//  CALLS TO:	  CreateNode, LogRecord, BuildSubtree
+//*****************************************************************************
+
+node* BuildSubtree (binaryTree *newTree, const int* keys, int first, int last)
+{
+	int middle = first + (last - first) / 2;	// index of subtree root
+	node *newNode;								// pointer to new node
+	
+	if (first >= last)
+	{
+		return NULL;
+	}
+	
+	// call CreateNode
+	// allocation failure - the run is not added
+	
+	newNode = CreateNode (keys[middle]);
+	
+	if (newNode == NULL)
+	{
+		cerr << last - first << " integers were not added." << endl;
+		return NULL;
+	}
+	
+	newTree->count++;
+	LogRecord (newTree, 'A', keys[middle]);
+	newNode->left = BuildSubtree (newTree, keys, first, middle);
+	newNode->right = BuildSubtree (newTree, keys, middle + 1, last);
+	
+	return newNode;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DeleteBatch
+//  DESCRIPTION:  deletes a batch of integers in one merged traversal;
+//				  the caller commits the logged changes
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								batch - integers being deleted from tree
+//										(sorted in place)
+//  OUTPUT: 	  Return value: number of integers deleted from the tree
+//  CALLS TO:	  DeleteRun, SetDelete, LogRecord
+//*****************************************************************************
+
+int DeleteBatch (binaryTree *newTree, vector<int>& batch)
+{
+	int before = newTree->count;	// count before the batch is applied
+	
+	// sort the batch and drop repeated integers
+	
+	sort (batch.begin(), batch.end());
+	batch.erase (unique (batch.begin(), batch.end()), batch.end());
+	
+	// compressed mode - call SetDelete
+	
+	if (newTree->set != NULL)
+	{
+		for (int i = 0; i < (int)batch.size(); i++)
+		{
+			if (SetDelete (newTree->set, batch[i]))
+			{
+				newTree->count--;
+				LogRecord (newTree, 'D', batch[i]);
+			}
+			
+			else if (!newTree->quiet)
+			{
+				cout << endl;
+				cerr << batch[i] << " was not found in binary tree!" << endl;
+			}
+		}
+	}
+	
+	// call DeleteRun from the root
+	
+	else if (!batch.empty())
+	{
+		DeleteRun (newTree, newTree->root, &batch[0], 0, batch.size());
+	}
+	
+	return before - newTree->count;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DeleteRun
+//  DESCRIPTION:  removes a sorted run of unique integers from a subtree;
+//				  children are processed before the node itself so each
+//				  node is visited once; a runTask stack marks whether a
+//				  node's children are already done
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								link - pointer to the subtree root
+//								keys - sorted integers being deleted
+//								first - index of first integer in run
+//								last - index one past the last integer in run
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  RemoveNode
+//*****************************************************************************
+
+void DeleteRun (binaryTree *newTree, node*& link, const int* keys, int first, int last)
+{
+	vector<runTask> pending;	// runs still to be removed
+	runTask task;				// run being removed
+	int split;					// first integer not less than the node
+	bool found;					// the node's integer is in the run
+	
+	pending.push_back (runTask {&link, first, last, false});
+	
+	while (!pending.empty())
+	{
+		task = pending.back();
+		pending.pop_back();
+		
+		// empty run - nothing to delete
+		
+		if (task.first >= task.last)
+		{
+			continue;
+		}
+		
+		// empty subtree - integers in run were not found
+		
+		if (*task.link == NULL)
+		{
+			for (int i = task.first; i < task.last && !newTree->quiet; i++)
+			{
+				cout << endl;
+				cerr << keys[i] << " was not found in binary tree!" << endl;
+			}
+			
+			continue;
+		}
+		
+		split = lower_bound (keys + task.first, keys + task.last, (*task.link)->num) - keys;
+		found = (split < task.last && keys[split] == (*task.link)->num);
+		
+		// children done - call RemoveNode
+		
+		if (task.visited)
+		{
+			if (found)
+			{
+				RemoveNode (newTree, *task.link);
+			}
+			
+			continue;
+		}
+		
+		// split the run around the current node
+		// the node waits below its children, the left run is handled first
+		
+		task.visited = true;
+		pending.push_back (task);
+		pending.push_back (runTask {&(*task.link)->right, found ? split + 1 : split, task.last, false});
+		pending.push_back (runTask {&(*task.link)->left, task.first, split, false});
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  RemoveNode
+//  DESCRIPTION:  unlinks and de-allocates a single node
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								link - pointer to the node being removed
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  LogRecord, InvalidateCache
+//*****************************************************************************
+
+void RemoveNode (binaryTree *newTree, node*& link)
+{
+	node *current;		// pointer to current node
+	node *parent;		// pointer to parent node
+	node* temp;			// pointer to node to be deleted
+	
+	// call LogRecord
+	
+	LogRecord (newTree, 'D', link->num);
+	
+	// call InvalidateCache
+	
+	InvalidateCache (newTree, link->num);
+	
+	// no left subtree
+	
+	if (link->left == NULL)
+	{
+		temp = link;
+		link = temp->right;
+		delete temp;
+	}
+	
+	// no right subtree
+	
+	else if (link->right == NULL)
+	{
+		temp = link;
+		link = temp->left;
+		delete temp;
+	}
+	
+	// nonempty left and right subtrees
+	// replace with in-order predecessor
+	
+	else
+	{
+		current = link->left;
+		parent = NULL;
+		
+		while (current->right != NULL)
+		{
+			parent = current;
+			current = current->right;
+		}
+		
+		// the predecessor's value moves, its node is freed
+		
+		InvalidateCache (newTree, current->num);
+		link->num = current->num;
+		
+		if (parent == NULL)
+		{
+			link->left = current->left;
+		}
+		
+		else
+		{
+			parent->right = current->left;
+		}
+		
+		delete current;
+	}
+	
+	newTree->count--;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  InOrderDisplay
+//  DESCRIPTION:  displays all integers in tree in order, keeping the
+//				  nodes above the current one on an explicit stack
+//  INPUT:        Parameters:	root - pointer to root node
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void InOrderDisplay (node* root)
+{
+	static int lastDisplayed = INT_MIN;
+	vector<node*> path;		// nodes whose integer is not yet displayed
+
+	while (root != NULL || !path.empty())
+	{
+		while (root != NULL)
+		{
+			path.push_back (root);
+			root = root->left;
+		}
+		
+		root = path.back();
+		path.pop_back();
+		
+		cout << setw(7) << root->num << " ";
+		lastDisplayed = root->num;
+			
+		root = root->right;
+	}	
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FreeNodes
+//  DESCRIPTION:  de-allocates all memory from the tree without recursion;
+//				  left children are rotated up until the root has none,
+//				  then it is freed
+//  INPUT:        Parameters:	root - pointer to root node
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void FreeNodes (node* root)
+{
+	node *child;		// left child being rotated up
+	
+	while (root != NULL)
+	{
+		if (root->left != NULL)
+		{
+			child = root->left;
+			root->left = child->right;
+			child->right = root;
+			root = child;
+		}
+		
+		else
+		{
+			child = root->right;
+			delete root;
+			root = child;
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DestroyTree
+//  DESCRIPTION:  de-allocates all nodes from the tree
+//  INPUT:        Parameters:	newTree - pointer to new binary tree 
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  FreeNodes, DestroySet
+//*****************************************************************************
+
+void DestroyTree (binaryTree* newTree)
+{
+	FreeNodes (newTree->root);
+	delete newTree->cache;
+	
+	if (newTree->set != NULL)
+	{
+		DestroySet (newTree->set);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CollectKeys
+//  DESCRIPTION:  lists all integers in the tree in ascending order
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								keys - receives the integers
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  CollectNodes, ContainerValues
+//*****************************************************************************
+
+void CollectKeys (binaryTree *newTree, vector<int>& keys)
+{
+	vector<uint16_t> lows;		// members of the current container
+	int base;					// upper 16 bits of the current container
+	
+	keys.clear();
+	keys.reserve (newTree->count);
+	
+	// pointer tree - call CollectNodes
+	
+	if (newTree->set == NULL)
+	{
+		CollectNodes (newTree->root, keys);
+		return;
+	}
+	
+	// compressed set - walk containers in order
+	
+	for (int c = 0; c < (int)newTree->set->containers.size(); c++)
+	{
+		ContainerValues (newTree->set->containers[c], lows);
+		base = int((uint32_t(newTree->set->containers[c].high) << 16) ^ SET_SIGN_BIT);
+		
+		for (int i = 0; i < (int)lows.size(); i++)
+		{
+			keys.push_back (base | lows[i]);
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CollectNodes
+//  DESCRIPTION:  lists all integers in a subtree in order; the path from
+//				  the root to the current node is kept in a vector
+//  INPUT:        Parameters:	root - pointer to subtree root
+//								keys - receives the integers
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void CollectNodes (node* root, vector<int>& keys)
+{
+	vector<node*> path;		// nodes whose integer is not yet listed
+	node *current = root;	// subtree being descended
+	
+	while (current != NULL || !path.empty())
+	{
+		// descend to the smallest integer not yet listed
+		
+		while (current != NULL)
+		{
+			path.push_back (current);
+			current = current->left;
+		}
+		
+		current = path.back();
+		path.pop_back();
+		keys.push_back (current->num);
+		current = current->right;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SyncFile
+//  DESCRIPTION:  flushes a file and forces its contents to stable storage
+//  INPUT:        Parameters:	file - open file
+//  OUTPUT: 	  Return value: true (if synced) / false (if an error occurred)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool SyncFile (FILE *file)
+{
+	if (fflush (file) != 0)
+	{
+		return false;
+	}
+	
+#ifdef _WIN32
+	return _commit (_fileno (file)) == 0;
+#else
+	return fsync (fileno (file)) == 0;
+#endif
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ReadSnapshot
+//  DESCRIPTION:  loads a compacted snapshot in place of the text file
+//				  up to the offset the snapshot records
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								filename - data filename
+//								offset - size of the text file, receives
+//										 the bytes of it held by the snapshot
+//  OUTPUT: 	  Return value: true (if a valid snapshot was loaded)
+//								false (if there is no usable snapshot)
+//  CALLS TO:	  DecodeNum, InsertBatch
+//*****************************************************************************
+
+bool ReadSnapshot (binaryTree *newTree, string& filename, long long& offset)
+{
+	string snapName = filename + SNAPSHOT_SUFFIX;	// snapshot filename
+	FILE *snapFile;									// snapshot file
+	char magic[sizeof (SNAPSHOT_MAGIC)];			// snapshot header
+	unsigned char bytes[4];							// encoded integer
+	unsigned char position[8];						// encoded text offset
+	bool valid;										// header is readable
+	uint32_t total;									// integers in snapshot
+	vector<int> batch;								// integers read
+	
+	snapFile = fopen (snapName.c_str(), "rb");
+	
+	if (snapFile == NULL)
+	{
+		return false;
+	}
+	
+	// validate header, text offset and integer count
+	// older snapshots have no offset and hold the whole text file
+	
+	valid = fread (magic, 1, sizeof (magic), snapFile) == sizeof (magic);
+	
+	if (valid && memcmp (magic, SNAPSHOT_MAGIC, sizeof (magic)) == 0)
+	{
+		valid = fread (position, 1, 8, snapFile) == 8;
+		offset = (long long)uint32_t(DecodeNum (position))
+				 | ((long long)uint32_t(DecodeNum (position + 4)) << 32);
+	}
+	
+	else
+	{
+		valid = valid && memcmp (magic, OLD_SNAPSHOT_MAGIC, sizeof (magic)) == 0;
+	}
+	
+	if (!valid || fread (bytes, 1, 4, snapFile) != 4)
+	{
+		fclose (snapFile);
+		cout << endl;
+		cerr << "Error - " << snapName << " is not a valid snapshot, ignoring it." << endl;
+		return false;
+	}
+	
+	total = DecodeNum (bytes);
+	batch.reserve (total);
+	
+	while (batch.size() < total && fread (bytes, 1, 4, snapFile) == 4)
+	{
+		batch.push_back (DecodeNum (bytes));
+	}
+	
+	fclose (snapFile);
+	
+	if (batch.size() != total)
+	{
+		cout << endl;
+		cerr << "Error - " << snapName << " is truncated, ignoring it." << endl;
+		return false;
+	}
+	
+	// call InsertBatch
+	
+	InsertBatch (newTree, batch);
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  OpenLog
+//  DESCRIPTION:  replays the operation log on top of the loaded data,
+//				  compacts it into a snapshot when it has grown large (or
+//				  has a torn tail), and attaches it to the tree for appends
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								filename - data filename
+//								offset - bytes of the text file held by
+//										 the snapshot
+//  OUTPUT: 	  Return value: true (if the log is attached)
+//								false (if the log could not be opened)
+//  CALLS TO:	  ReplayLog, CompactLog
+//*****************************************************************************
+
+bool OpenLog (binaryTree *newTree, string& filename, long long offset)
+{
+	opLog *log = new opLog;		// operation log
+	bool torn = false;			// log ends in a partial record
+	int replayed;				// records applied from the log
+	
+	log->file = NULL;
+	log->logName = filename + LOG_SUFFIX;
+	log->snapName = filename + SNAPSHOT_SUFFIX;
+	log->pendingCount = 0;
+	log->records = 0;
+	log->textOffset = offset;
+	
+	// call ReplayLog
+	
+	replayed = ReplayLog (newTree, log, torn);
+	
+	if (replayed > 0)
+	{
+		cout << endl;
+		cout << "Replayed " << replayed << " logged changes." << endl;
+		cout << "There are " << newTree->count << " integers in the binary search tree." << endl;
+	}
+	
+	if (torn)
+	{
+		cout << endl;
+		cerr << "Warning - " << log->logName << " ends in a partial record." << endl;
+	}
+	
+	// large or damaged log - call CompactLog
+	
+	if (torn || log->records >= COMPACT_RECORDS)
+	{
+		if (!CompactLog (newTree, log))
+		{
+			delete log;
+			return false;
+		}
+	}
+	
+	// open existing log for appending, or start a new one
+	
+	else
+	{
+		log->file = fopen (log->logName.c_str(), "ab");
+		
+		// records are already gathered in pending, write them straight through
+		
+		if (log->file != NULL)
+		{
+			setvbuf (log->file, NULL, _IONBF, 0);
+		}
+		
+		if (log->file != NULL && ftell (log->file) == 0)
+		{
+			fwrite (LOG_MAGIC, 1, sizeof (LOG_MAGIC), log->file);
+			SyncFile (log->file);
+		}
+	}
+	
+	if (log->file == NULL)
+	{
+		cout << endl;
+		cerr << "Error - unable to open " << log->logName << ", changes will not be saved." << endl;
+		delete log;
+		return false;
+	}
+	
+	newTree->log = log;
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ReplayLog
+//  DESCRIPTION:  applies logged changes to the tree; consecutive records
+//				  of the same kind are applied as one batch, and text offset
+//				  records advance the position held by the log
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								log - operation log being replayed
+//								torn - set true if the log ends in a
+//									   partial or corrupt record
+//  OUTPUT: 	  Return value: number of records applied
+//  CALLS TO:	  InsertBatch, DeleteBatch, DecodeNum
+//*****************************************************************************
+
+int ReplayLog (binaryTree *newTree, opLog *log, bool& torn)
+{
+	FILE *logFile;								// log file
+	char magic[sizeof (LOG_MAGIC)];				// log header
+	unsigned char record[LOG_RECORD_BYTES];		// encoded record
+	char batchOp = 0;							// operation of current batch
+	vector<int> batch;							// integers in current batch
+	size_t got;									// bytes read
+	
+	logFile = fopen (log->logName.c_str(), "rb");
+	
+	if (logFile == NULL)
+	{
+		return 0;
+	}
+	
+	// validate header
+	
+	got = fread (magic, 1, sizeof (magic), logFile);
+	
+	if (got != sizeof (magic) || memcmp (magic, LOG_MAGIC, sizeof (magic)) != 0)
+	{
+		torn = (got > 0);
+		fclose (logFile);
+		return 0;
+	}
+	
+	// a change may already be in the tree if the text offset record after
+	// it was lost, so replay does not print per-integer messages
+	
+	newTree->quiet = true;
+	
+	while ((got = fread (record, 1, LOG_RECORD_BYTES, logFile)) == LOG_RECORD_BYTES)
+	{
+		// corrupt record - stop replay here
+		
+		if ((record[0] != 'A' && record[0] != 'D' && record[0] != 'O')
+			|| record[5] != LogChecksum (record))
+		{
+			torn = true;
+			break;
+		}
+		
+		// text offset - does not change the tree
+		
+		if (record[0] == 'O')
+		{
+			log->textOffset += DecodeNum (record + 1);
+			log->records++;
+			continue;
+		}
+		
+		// operation changed - apply the pending batch
+		
+		if (record[0] != batchOp && !batch.empty())
+		{
+			if (batchOp == 'A')
+			{
+				InsertBatch (newTree, batch);
+			}
+			
+			else
+			{
+				DeleteBatch (newTree, batch);
+			}
+			
+			batch.clear();
+		}
+		
+		batchOp = record[0];
+		batch.push_back (DecodeNum (record + 1));
+		log->records++;
+	}
+	
+	if (got > 0 && got < LOG_RECORD_BYTES)
+	{
+		torn = true;
+	}
+	
+	fclose (logFile);
+	
+	// apply the final batch
+	
+	if (batchOp == 'A')
+	{
+		InsertBatch (newTree, batch);
+	}
+	
+	else if (batchOp == 'D')
+	{
+		DeleteBatch (newTree, batch);
+	}
+	
+	newTree->quiet = false;
+	
+	return log->records;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CompactLog
+//  DESCRIPTION:  writes the tree to a new snapshot and starts an empty log;
+//				  the snapshot is written to a temporary file and renamed
+//				  so a crash never leaves a partial snapshot behind
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								log - operation log being compacted
+//  OUTPUT: 	  Return value: true (if compacted) / false (if an error occurred)
+//  CALLS TO:	  CollectKeys, EncodeNum, SyncFile
+//*****************************************************************************
+
+bool CompactLog (binaryTree *newTree, opLog *log)
+{
+	string tempName = log->snapName + ".tmp";	// snapshot being written
+	FILE *snapFile;								// snapshot file
+	vector<int> keys;							// integers in the tree
+	unsigned char bytes[4];						// encoded integer
+	unsigned char position[8];					// encoded text offset
+	bool written;								// snapshot fully written
+	
+	// call CollectKeys
+	
+	CollectKeys (newTree, keys);
+	
+	// write the snapshot
+	
+	snapFile = fopen (tempName.c_str(), "wb");
+	
+	if (snapFile == NULL)
+	{
+		cout << endl;
+		cerr << "Error - unable to write " << tempName << endl;
+		return false;
+	}
+	
+	EncodeNum (log->textOffset & 0xFFFFFFFF, position);
+	EncodeNum (log->textOffset >> 32, position + 4);
+	EncodeNum (keys.size(), bytes);
+	written = fwrite (SNAPSHOT_MAGIC, 1, sizeof (SNAPSHOT_MAGIC), snapFile) == sizeof (SNAPSHOT_MAGIC)
+			  && fwrite (position, 1, 8, snapFile) == 8
+			  && fwrite (bytes, 1, 4, snapFile) == 4;
+	
+	for (int i = 0; written && i < (int)keys.size(); i++)
+	{
+		EncodeNum (keys[i], bytes);
+		written = fwrite (bytes, 1, 4, snapFile) == 4;
+	}
+	
+	written = written && SyncFile (snapFile);
+	fclose (snapFile);
+	
+	// replace the old snapshot
+	
+#ifdef _WIN32
+	remove (log->snapName.c_str());
+#endif
+	
+	if (!written || rename (tempName.c_str(), log->snapName.c_str()) != 0)
+	{
+		remove (tempName.c_str());
+		cout << endl;
+		cerr << "Error - unable to write " << log->snapName << endl;
+		return false;
+	}
+	
+	// start an empty log
+	
+	if (log->file != NULL)
+	{
+		fclose (log->file);
+	}
+	
+	log->file = fopen (log->logName.c_str(), "wb");
+	
+	if (log->file == NULL)
+	{
+		cout << endl;
+		cerr << "Error - unable to write " << log->logName << endl;
+		return false;
+	}
+	
+	setvbuf (log->file, NULL, _IONBF, 0);
+	fwrite (LOG_MAGIC, 1, sizeof (LOG_MAGIC), log->file);
+	SyncFile (log->file);
+	log->records = 0;
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LogRecord
+//  DESCRIPTION:  queues a change for the next group commit; every
+//				  caller that changes the tree commits once it releases
+//				  the tree lock
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								op - 'A' (integer added), 'D' (deleted) or
+//									 'O' (text offset advanced)
+//								num - integer added or deleted, or bytes
+//									  the text offset advanced
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  EncodeNum, LogChecksum
+//*****************************************************************************
+
+void LogRecord (binaryTree *newTree, char op, int num)
+{
+	opLog *log = newTree->log;					// operation log
+	unsigned char record[LOG_RECORD_BYTES];		// encoded record
+	
+	// persistence is not enabled
+	
+	if (log == NULL)
+	{
+		return;
+	}
+	
+	record[0] = op;
+	EncodeNum (num, record + 1);
+	record[5] = LogChecksum (record);
+	
+	lock_guard<mutex> guard (log->queueLock);
+	
+	log->pending.insert (log->pending.end(), record, record + LOG_RECORD_BYTES);
+	log->pendingCount++;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LogOffset
+//  DESCRIPTION:  queues the text file position the tree now holds, so a
+//				  restart reads only the text appended after it
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								offset - bytes of the text file in the tree
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  LogRecord
+//*****************************************************************************
+
+void LogOffset (binaryTree *newTree, long long offset)
+{
+	opLog *log = newTree->log;		// operation log
+	long long step;					// bytes advanced by one record
+	
+	// persistence is not enabled
+	
+	if (log == NULL)
+	{
+		return;
+	}
+	
+	// a record holds at most INT_MAX bytes either way
+	
+	while (offset != log->textOffset)
+	{
+		step = max (min (offset - log->textOffset, (long long)INT_MAX), -(long long)INT_MAX);
+		LogRecord (newTree, 'O', (int)step);
+		log->textOffset += step;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CommitLog
+//  DESCRIPTION:  appends all queued changes and syncs them with one fsync;
+//				  on failure the changes stay queued and the next commit
+//				  retries them; does not need the tree lock, so callers
+//				  commit after releasing it
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//  OUTPUT: 	  Return value: true (if committed) / false (if an error occurred)
+//  CALLS TO:	  SyncFile
+//*****************************************************************************
+
+bool CommitLog (binaryTree *newTree)
+{
+	opLog *log = newTree->log;			// operation log
+	vector<unsigned char> records;		// records taken from the queue
+	int count;							// number of records taken
+	long long committed;				// log size before this commit
+	bool written;						// records fully written
+	
+	if (log == NULL)
+	{
+		return true;
+	}
+	
+	// one commit at a time, so records reach the file in queue order
+	
+	lock_guard<mutex> writing (log->writeLock);
+	
+	// take the queue - changes made meanwhile wait for the next commit
+	
+	{
+		lock_guard<mutex> guard (log->queueLock);
+		
+		if (log->pendingCount == 0)
+		{
+			return true;
+		}
+		
+		records.swap (log->pending);
+		count = log->pendingCount;
+		log->pendingCount = 0;
+	}
+	
+	committed = ftell (log->file);
+	written = committed >= 0
+			  && fwrite (&records[0], 1, records.size(), log->file) == records.size()
+			  && SyncFile (log->file);
+	
+	// failed - cut off any partial write so the retry starts on a record
+	
+	if (!written)
+	{
+		clearerr (log->file);
+		
+#ifdef _WIN32
+		if (committed >= 0 && _chsize_s (_fileno (log->file), committed) == 0)
+#else
+		if (committed >= 0 && ftruncate (fileno (log->file), committed) == 0)
+#endif
+		{
+			fseek (log->file, 0, SEEK_END);
+		}
+		
+		// put the records back ahead of any queued since
+		
+		lock_guard<mutex> guard (log->queueLock);
+		
+		log->pending.insert (log->pending.begin(), records.begin(), records.end());
+		log->pendingCount += count;
+		
+		return false;
+	}
+	
+	log->records += count;
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CloseLog
+//  DESCRIPTION:  commits queued changes and detaches the log from the tree
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  CommitLog
+//*****************************************************************************
+
+void CloseLog (binaryTree *newTree)
+{
+	if (newTree->log == NULL)
+	{
+		return;
+	}
+	
+	if (!CommitLog (newTree))
+	{
+		cout << endl;
+		cerr << "Error - unable to write " << newTree->log->logName << ", "
+			 << newTree->log->pendingCount << " changes were not saved." << endl;
+	}
+	
+	fclose (newTree->log->file);
+	delete newTree->log;
+	newTree->log = NULL;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  EncodeNum
+//  DESCRIPTION:  stores an integer as 4 little-endian bytes
+//  INPUT:        Parameters:	num - integer being stored
+//								bytes - receives the encoded integer
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void EncodeNum (uint32_t num, unsigned char* bytes)
+{
+	bytes[0] = num & 0xFF;
+	bytes[1] = (num >> 8) & 0xFF;
+	bytes[2] = (num >> 16) & 0xFF;
+	bytes[3] = (num >> 24) & 0xFF;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DecodeNum
+//  DESCRIPTION:  reads an integer stored as 4 little-endian bytes
+//  INPUT:        Parameters:	bytes - encoded integer
+//  OUTPUT: 	  Return value: decoded integer
+//  CALLS TO:	  none
+//*****************************************************************************
+
+int DecodeNum (const unsigned char* bytes)
+{
+	return int(uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8)
+			   | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24));
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LogChecksum
+//  DESCRIPTION:  computes the check byte of a log record
+//  INPUT:        Parameters:	record - operation and encoded integer
+//  OUTPUT: 	  Return value: check byte
+//  CALLS TO:	  none
+//*****************************************************************************
+
+unsigned char LogChecksum (const unsigned char* record)
+{
+	return 0x5A ^ record[0] ^ record[1] ^ record[2] ^ record[3] ^ record[4];
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ResetParser
+//  DESCRIPTION:  clears the state of an incremental text parser
+//  INPUT:        Parameters:	parser - parser being reset
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void ResetParser (textParser& parser)
+{
+	parser.value = 0;
+	parser.digits = 0;
+	parser.pendingBytes = 0;
+	parser.negative = false;
+	parser.failed = false;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ParseChunk
+//  DESCRIPTION:  parses whitespace separated integers from a block of text;
+//				  an integer cut off at the end of the block is carried over
+//				  to the next call, and parsing stops at non-integer text
+//				  the same way extraction with >> does
+//  INPUT:        Parameters:	parser - state carried between blocks
+//								data - block of text
+//								size - number of characters in block
+//								nums - receives the parsed integers
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  EndNumber
+//*****************************************************************************
+
+void ParseChunk (textParser& parser, const char* data, long long size, vector<int>& nums)
+{
+	unsigned char c;	// current character
+	
+	for (long long i = 0; i < size && !parser.failed; i++)
+	{
+		c = data[i];
+		
+		// whitespace ends the integer being parsed
+		
+		if (isspace (c))
+		{
+			if (parser.pendingBytes > 0)
+			{
+				EndNumber (parser, nums);
+			}
+		}
+		
+		// leading sign
+		
+		else if ((c == '-' || c == '+') && parser.pendingBytes == 0)
+		{
+			parser.negative = (c == '-');
+			parser.pendingBytes++;
+		}
+		
+		// digit - reject values outside the int range
+		
+		else if (isdigit (c))
+		{
+			parser.value = parser.value * 10 + (c - '0');
+			parser.digits++;
+			parser.pendingBytes++;
+			
+			if (parser.value > (long long)INT_MAX + parser.negative)
+			{
+				parser.failed = true;
+			}
+		}
+		
+		else
+		{
+			parser.failed = true;
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  EndNumber
+//  DESCRIPTION:  stores the integer being parsed and starts a new one
+//  INPUT:        Parameters:	parser - incremental text parser
+//								nums - receives the parsed integer
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void EndNumber (textParser& parser, vector<int>& nums)
+{
+	// a sign without digits is not an integer
+	
+	if (parser.digits == 0)
+	{
+		parser.failed = true;
+		return;
+	}
+	
+	nums.push_back (int(parser.negative ? -parser.value : parser.value));
+	parser.value = 0;
+	parser.digits = 0;
+	parser.pendingBytes = 0;
+	parser.negative = false;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LoadFile
+//  DESCRIPTION:  reads a text file with several large reads in flight,
+//				  parsing and inserting each block while the following
+//				  blocks are still being read; io_uring is used where the
+//				  kernel allows it, otherwise a read-ahead thread
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								filename - data filename
+//								parser - state carried between blocks
+//								batch - receives integers not yet inserted
+//								stats - receives I/O wait and CPU times
+//								uring - try io_uring first
+//								offset - file position to read from
+//  OUTPUT: 	  Return value: bytes of the text file read
+//  CALLS TO:	  UringLoad, ThreadLoad
+//*****************************************************************************
+
+long long LoadFile (binaryTree *newTree, string& filename, textParser& parser,
+					vector<int>& batch, loadStats& stats, bool uring, long long offset)
+{
+	long long loaded = -1;		// bytes read (-1 - io_uring unavailable)
+	
+	stats.bytes = 0;
+	stats.ioWait = 0;
+	stats.cpu = 0;
+	
+#ifdef HAVE_IO_URING
+	if (uring)
+	{
+		stats.method = "io_uring";
+		loaded = UringLoad (newTree, filename, parser, batch, stats, offset);
+	}
+#else
+	(void)uring;
+#endif
+	
+	// no io_uring - call ThreadLoad
+	
+	if (loaded < 0)
+	{
+		stats.method = "read-ahead thread";
+		loaded = ThreadLoad (newTree, filename, parser, batch, stats, offset);
+	}
+	
+	stats.bytes = loaded;
+	
+	return loaded;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LoadBlock
+//  DESCRIPTION:  parses a block read by the loader, inserting the parsed
+//				  integers once enough have collected
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								parser - state carried between blocks
+//								batch - integers not yet inserted
+//								data - block of text
+//								size - number of characters in block
+//								stats - CPU time is added here
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ParseChunk, InsertBatch
+//*****************************************************************************
+
+void LoadBlock (binaryTree *newTree, textParser& parser, vector<int>& batch,
+				const char* data, long long size, loadStats& stats)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	ParseChunk (parser, data, size, batch);
+	
+	// small files are still built in one balanced batch
+	
+	if ((int)batch.size() >= LOAD_INSERT_BATCH)
+	{
+		InsertBatch (newTree, batch);
+		batch.clear();
+	}
+	
+	stats.cpu += chrono::duration<double> (chrono::steady_clock::now() - start).count();
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ThreadLoad
+//  DESCRIPTION:  loads a text file while a read-ahead thread fills the
+//				  next buffers of a ring
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								filename - data filename
+//								parser - state carried between blocks
+//								batch - receives integers not yet inserted
+//								stats - receives I/O wait and CPU times
+//								offset - file position to read from
+//  OUTPUT: 	  Return value: bytes of the text file read
+//  CALLS TO:	  ReadAhead, LoadBlock
+//*****************************************************************************
+
+long long ThreadLoad (binaryTree *newTree, string& filename, textParser& parser,
+					  vector<int>& batch, loadStats& stats, long long offset)
+{
+	readAhead reader;			// buffers shared with the read-ahead thread
+	long long loaded = 0;		// bytes parsed
+	long long size;				// bytes in the current buffer
+	int slot = 0;				// buffer being parsed
+	
+	reader.filename = filename;
+	reader.offset = offset;
+	reader.stop = false;
+	
+	for (int i = 0; i < LOAD_BUFFERS; i++)
+	{
+		reader.buffers[i].data.resize (LOAD_BUFFER_BYTES);
+		reader.buffers[i].size = 0;
+		reader.buffers[i].ready = false;
+	}
+	
+	// start read-ahead thread
+	
+	reader.worker = thread (ReadAhead, &reader);
+	
+	do
+	{
+		// wait for the buffer to be filled
+		
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		{
+			unique_lock<mutex> guard (reader.lock);
+			
+			reader.changed.wait (guard, [&] { return reader.buffers[slot].ready; });
+			size = reader.buffers[slot].size;
+		}
+		stats.ioWait += chrono::duration<double> (chrono::steady_clock::now() - start).count();
+		
+		LoadBlock (newTree, parser, batch, &reader.buffers[slot].data[0], size, stats);
+		loaded += size;
+		
+		// hand the buffer back to the read-ahead thread
+		
+		{
+			lock_guard<mutex> guard (reader.lock);
+			
+			reader.buffers[slot].ready = false;
+			reader.stop = parser.failed;
+		}
+		reader.changed.notify_all();
+		slot = (slot + 1) % LOAD_BUFFERS;
+	} while (size > 0 && !parser.failed);
+	
+	// wait for read-ahead thread
+	
+	{
+		lock_guard<mutex> guard (reader.lock);
+		
+		reader.stop = true;
+	}
+	reader.changed.notify_all();
+	reader.worker.join();
+	
+	return loaded;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ReadAhead
+//  DESCRIPTION:  read-ahead thread, fills the buffer ring in order until
+//				  the end of the file; an empty buffer marks the end
+//  INPUT:        Parameters:	reader - buffers shared with the loader
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void ReadAhead (readAhead *reader)
+{
+	ifstream infile;			// for reading text file
+	long long size;				// bytes read into the buffer
+	int slot = 0;				// buffer being filled
+	
+	infile.open (reader->filename.c_str(), ios::binary);
+	infile.seekg (reader->offset);
+	
+	do
+	{
+		// wait for the loader to finish with the buffer
+		
+		{
+			unique_lock<mutex> guard (reader->lock);
+			
+			reader->changed.wait (guard, [&] { return !reader->buffers[slot].ready
+													  || reader->stop; });
+			
+			if (reader->stop)
+			{
+				return;
+			}
+		}
+		
+		// the loader never touches a buffer that is not ready
+		
+		infile.read (&reader->buffers[slot].data[0], LOAD_BUFFER_BYTES);
+		size = infile.gcount();
+		
+		{
+			lock_guard<mutex> guard (reader->lock);
+			
+			reader->buffers[slot].size = size;
+			reader->buffers[slot].ready = true;
+		}
+		reader->changed.notify_all();
+		slot = (slot + 1) % LOAD_BUFFERS;
+	} while (size > 0);
+}
+
+#ifdef HAVE_IO_URING
+
+//*****************************************************************************
+//  FUNCTION:	  UringLoad
+//  DESCRIPTION:  loads a text file keeping a read queued in io_uring for
+//				  every buffer of the ring, the rest of the file is loaded
+//				  with the read-ahead thread if io_uring fails part way
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								filename - data filename
+//								parser - state carried between blocks
+//								batch - receives integers not yet inserted
+//								stats - receives I/O wait and CPU times
+//								offset - file position to read from
+//  OUTPUT: 	  Return value: bytes of the text file read
+//								-1 (io_uring unavailable, nothing read)
+//  CALLS TO:	  OpenRing, SubmitRead, WaitRead, LoadBlock, CloseRing,
+//				  ThreadLoad
+//*****************************************************************************
+
+long long UringLoad (binaryTree *newTree, string& filename, textParser& parser,
+					 vector<int>& batch, loadStats& stats, long long offset)
+{
+	uringQueue ring;							// submission/completion rings
+	char *buffers[LOAD_BUFFERS];				// blocks being read
+	long long results[LOAD_BUFFERS];			// bytes read, -1 while queued
+	bool queued[LOAD_BUFFERS];					// buffer has a read queued
+	bool failed = false;						// io_uring_enter failed
+	struct stat info;							// size of the text file
+	long long end;								// bytes after the start position
+	long long blocks;							// blocks in the text file
+	long long loaded = 0;						// bytes parsed
+	long long size;								// bytes in the current block
+	ssize_t extra;								// bytes of a short read top-up
+	int slot;									// buffer being parsed
+	int fd;										// text file
+	
+	fd = open (filename.c_str(), O_RDONLY);
+	
+	if (fd < 0 || fstat (fd, &info) != 0 || !OpenRing (ring, LOAD_BUFFERS))
+	{
+		if (fd >= 0)
+		{
+			close (fd);
+		}
+		
+		return -1;
+	}
+	
+	end = max (info.st_size - offset, 0LL);
+	blocks = (end + LOAD_BUFFER_BYTES - 1) / LOAD_BUFFER_BYTES;
+	
+	// queue the first reads
+	
+	for (int i = 0; i < LOAD_BUFFERS; i++)
+	{
+		buffers[i] = new char[LOAD_BUFFER_BYTES];
+		results[i] = -1;
+		queued[i] = (i < blocks && !failed);
+		
+		if (queued[i])
+		{
+			failed = !SubmitRead (ring, fd, buffers[i], offset + (long long)i * LOAD_BUFFER_BYTES, i);
+		}
+	}
+	
+	for (long long b = 0; b < blocks && !parser.failed && !failed; b++)
+	{
+		slot = b % LOAD_BUFFERS;
+		
+		// wait for the block
+		
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		
+		if (!WaitRead (ring, results, slot))
+		{
+			failed = true;
+			break;
+		}
+		
+		queued[slot] = false;
+		size = max (results[slot], 0LL);
+		results[slot] = -1;
+		
+		// failed or short read - finish the block with pread
+		
+		while (size < LOAD_BUFFER_BYTES && b * LOAD_BUFFER_BYTES + size < end)
+		{
+			extra = pread (fd, &buffers[slot][size], LOAD_BUFFER_BYTES - size,
+						   offset + b * LOAD_BUFFER_BYTES + size);
+			
+			if (extra <= 0)
+			{
+				break;
+			}
+			
+			size += extra;
+		}
+		
+		stats.ioWait += chrono::duration<double> (chrono::steady_clock::now() - start).count();
+		
+		LoadBlock (newTree, parser, batch, buffers[slot], size, stats);
+		loaded += size;
+		
+		// queue the read of a later block into the free buffer
+		
+		if (b + LOAD_BUFFERS < blocks && !parser.failed)
+		{
+			queued[slot] = true;
+			failed = !SubmitRead (ring, fd, buffers[slot],
+								  offset + (b + LOAD_BUFFERS) * LOAD_BUFFER_BYTES, slot);
+		}
+	}
+	
+	// reads still queued write into the buffers, wait for them
+	
+	for (int i = 0; i < LOAD_BUFFERS && !failed; i++)
+	{
+		if (queued[i])
+		{
+			failed = !WaitRead (ring, results, i);
+			queued[i] = failed;
+		}
+	}
+	
+	CloseRing (ring);
+	close (fd);
+	
+	// a buffer whose read may still be in flight is left allocated, the
+	// kernel can write into it after the ring is closed
+	
+	for (int i = 0; i < LOAD_BUFFERS; i++)
+	{
+		if (!queued[i])
+		{
+			delete [] buffers[i];
+		}
+	}
+	
+	// io_uring failed - call ThreadLoad for the rest of the file
+	
+	if (failed && !parser.failed)
+	{
+		stats.method = "io_uring, then read-ahead thread";
+		loaded += ThreadLoad (newTree, filename, parser, batch, stats, offset + loaded);
+	}
+	
+	return loaded;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  OpenRing
+//  DESCRIPTION:  creates an io_uring instance and maps its rings
+//  INPUT:        Parameters:	ring - receives the mapped rings
+//								entries - reads that can be queued
+//  OUTPUT: 	  Return value: true (ring ready)
+//								false (io_uring unavailable)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool OpenRing (uringQueue& ring, unsigned entries)
+{
+	io_uring_params params;		// ring sizes and offsets from the kernel
+	
+	memset (&params, 0, sizeof (params));
+	ring.ringFd = syscall (__NR_io_uring_setup, entries, &params);
+	
+	if (ring.ringFd < 0)
+	{
+		return false;
+	}
+	
+	ring.sqRingBytes = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+	ring.cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+	ring.sqeBytes = params.sq_entries * sizeof (io_uring_sqe);
+	
+	// newer kernels map both rings at once
+	
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		ring.sqRingBytes = ring.cqRingBytes = max (ring.sqRingBytes, ring.cqRingBytes);
+	}
+	
+	ring.sqRing = mmap (NULL, ring.sqRingBytes, PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_POPULATE, ring.ringFd, IORING_OFF_SQ_RING);
+	ring.cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring.sqRing
+				  : mmap (NULL, ring.cqRingBytes, PROT_READ | PROT_WRITE,
+						  MAP_SHARED | MAP_POPULATE, ring.ringFd, IORING_OFF_CQ_RING);
+	ring.sqes = (io_uring_sqe*)mmap (NULL, ring.sqeBytes, PROT_READ | PROT_WRITE,
+									 MAP_SHARED | MAP_POPULATE, ring.ringFd, IORING_OFF_SQES);
+	
+	if (ring.sqRing == MAP_FAILED || ring.cqRing == MAP_FAILED || ring.sqes == MAP_FAILED)
+	{
+		CloseRing (ring);
+		return false;
+	}
+	
+	ring.sqTail = (unsigned*)((char*)ring.sqRing + params.sq_off.tail);
+	ring.sqMask = (unsigned*)((char*)ring.sqRing + params.sq_off.ring_mask);
+	ring.sqArray = (unsigned*)((char*)ring.sqRing + params.sq_off.array);
+	ring.cqHead = (unsigned*)((char*)ring.cqRing + params.cq_off.head);
+	ring.cqTail = (unsigned*)((char*)ring.cqRing + params.cq_off.tail);
+	ring.cqMask = (unsigned*)((char*)ring.cqRing + params.cq_off.ring_mask);
+	ring.cqes = (io_uring_cqe*)((char*)ring.cqRing + params.cq_off.cqes);
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SubmitRead
+//  DESCRIPTION:  queues a read of one block into a loader buffer
+//  INPUT:        Parameters:	ring - io_uring rings
+//								fd - text file
+//								buffer - receives the block
+//								offset - file position of the block
+//								slot - buffer index, returned on completion
+//  OUTPUT: 	  Return value: true (read queued)
+//								false (io_uring_enter failed)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool SubmitRead (uringQueue& ring, int fd, char* buffer, long long offset, int slot)
+{
+	unsigned tail = *ring.sqTail;					// next free entry
+	unsigned index = tail & *ring.sqMask;			// entry in the ring
+	io_uring_sqe *sqe = &ring.sqes[index];			// read request
+	long submitted;									// entries taken by the kernel
+	
+	memset (sqe, 0, sizeof (*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buffer;
+	sqe->len = LOAD_BUFFER_BYTES;
+	sqe->off = offset;
+	sqe->user_data = slot;
+	ring.sqArray[index] = index;
+	
+	// publish the entry before the kernel reads the tail
+	
+	__atomic_store_n (ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+	
+	do
+	{
+		submitted = syscall (__NR_io_uring_enter, ring.ringFd, 1, 0, 0, NULL, 0);
+	} while (submitted < 0 && errno == EINTR);
+	
+	return submitted == 1;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  WaitRead
+//  DESCRIPTION:  collects completed reads until a given buffer is filled;
+//				  reads that finish out of order are kept for later
+//  INPUT:        Parameters:	ring - io_uring rings
+//								results - bytes read per buffer, -1 if queued
+//								slot - buffer waited for
+//  OUTPUT: 	  Return value: true (buffer filled or its read failed)
+//								false (io_uring_enter failed)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool WaitRead (uringQueue& ring, long long* results, int slot)
+{
+	unsigned head;			// next completion to collect
+	io_uring_cqe *cqe;		// completed read
+	
+	while (results[slot] == -1)
+	{
+		head = *ring.cqHead;
+		
+		// nothing completed - block in the kernel
+		
+		if (head == __atomic_load_n (ring.cqTail, __ATOMIC_ACQUIRE))
+		{
+			if (syscall (__NR_io_uring_enter, ring.ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+				&& errno != EINTR)
+			{
+				return false;
+			}
+			
+			continue;
+		}
+		
+		// failed reads are redone with pread by the caller
+		
+		cqe = &ring.cqes[head & *ring.cqMask];
+		results[cqe->user_data] = max (cqe->res, 0);
+		__atomic_store_n (ring.cqHead, head + 1, __ATOMIC_RELEASE);
+	}
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CloseRing
+//  DESCRIPTION:  unmaps the rings and closes an io_uring instance
+//  INPUT:        Parameters:	ring - io_uring rings
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void CloseRing (uringQueue& ring)
+{
+	if (ring.sqes != MAP_FAILED)
+	{
+		munmap (ring.sqes, ring.sqeBytes);
+	}
+	
+	if (ring.cqRing != MAP_FAILED && ring.cqRing != ring.sqRing)
+	{
+		munmap (ring.cqRing, ring.cqRingBytes);
+	}
+	
+	if (ring.sqRing != MAP_FAILED)
+	{
+		munmap (ring.sqRing, ring.sqRingBytes);
+	}
+	
+	close (ring.ringFd);
+}
+
+#endif
+
+//*****************************************************************************
+//  FUNCTION:	  StartFollow
+//  DESCRIPTION:  starts a background thread that inserts integers appended
+//				  to the data file after it was loaded
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								filename - data filename
+//								offset - bytes of the file already loaded
+//  OUTPUT: 	  Return value: pointer to the running follower
+//  CALLS TO:	  ResetParser, FollowFile
+//*****************************************************************************
+
+fileFollower* StartFollow (binaryTree *newTree, string& filename, long long offset)
+{
+	fileFollower *follower = new fileFollower;	// pointer to new follower
+	
+	follower->tree = newTree;
+	follower->filename = filename;
+	follower->offset = offset;
+	follower->stop = false;
+	ResetParser (follower->parser);
+	
+	// call FollowFile on its own thread
+	
+	follower->worker = thread (FollowFile, follower);
+	
+	return follower;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FollowFile
+//  DESCRIPTION:  follow thread - reads new data each time the file changes;
+//				  changes are reported by inotify where available, otherwise
+//				  the file is polled
+//  INPUT:        Parameters:	follower - pointer to follower
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  FollowPass
+//*****************************************************************************
+
+void FollowFile (fileFollower *follower)
+{
+#ifdef __linux__
+	char events[4096];		// drained inotify events
+	pollfd ready;			// inotify readiness
+	int notifyFd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);	// inotify instance
+	
+	if (notifyFd >= 0
+		&& inotify_add_watch (notifyFd, follower->filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0)
+	{
+		close (notifyFd);
+		notifyFd = -1;
+	}
+#endif
+	
+	while (!follower->stop)
+	{
+		// call FollowPass
+		
+		FollowPass (follower);
+		
+		// wait for the file to change
+		
+#ifdef __linux__
+		if (notifyFd >= 0)
+		{
+			ready.fd = notifyFd;
+			ready.events = POLLIN;
+			
+			if (poll (&ready, 1, FOLLOW_POLL_MS) > 0)
+			{
+				while (read (notifyFd, events, sizeof (events)) > 0)
+				{
+				}
+			}
+			
+			continue;
+		}
+#endif
+		
+		this_thread::sleep_for (chrono::milliseconds (FOLLOW_POLL_MS));
+	}
+	
+#ifdef __linux__
+	if (notifyFd >= 0)
+	{
+		close (notifyFd);
+	}
+#endif
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FollowPass
+//  DESCRIPTION:  parses data appended since the last pass and inserts it in
+//				  batches; the tree is only locked while a batch is inserted,
+//				  so queries are never held up by file reads or parsing
+//  INPUT:        Parameters:	follower - pointer to follower
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ResetParser, ParseChunk, ApplyFollowBatch
+//*****************************************************************************
+
+void FollowPass (fileFollower *follower)
+{
+	ifstream infile;						// for reading text file
+	vector<char> buffer (READ_CHUNK_BYTES);	// block of new data
+	vector<int> batch;						// integers awaiting insertion
+	long long size;							// current file size
+	
+	infile.open (follower->filename.c_str(), ios::binary);
+	
+	if (!infile || follower->parser.failed)
+	{
+		return;
+	}
+	
+	infile.seekg (0, ios::end);
+	size = infile.tellg();
+	
+	// file was truncated - start again from the beginning
+	
+	if (size < follower->offset)
+	{
+		follower->offset = 0;
+		ResetParser (follower->parser);
+	}
+	
+	if (size == follower->offset)
+	{
+		return;
+	}
+	
+	infile.seekg (follower->offset);
+	
+	// parse new data, inserting every FOLLOW_BATCH integers
+	
+	do
+	{
+		infile.read (&buffer[0], buffer.size());
+		ParseChunk (follower->parser, &buffer[0], infile.gcount(), batch);
+		follower->offset += infile.gcount();
+		
+		if ((int)batch.size() >= FOLLOW_BATCH)
+		{
+			ApplyFollowBatch (follower, batch);
+		}
+	} while (infile && !follower->parser.failed && !follower->stop);
+	
+	ApplyFollowBatch (follower, batch);
+	
+	if (follower->parser.failed)
+	{
+		cout << endl;
+		cerr << "Error - " << follower->filename << " contains non-integer data, "
+			 << "no longer following it." << endl;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ApplyFollowBatch
+//  DESCRIPTION:  inserts a batch of followed integers under the tree lock
+//				  and logs the file position they were read up to; the log
+//				  is committed after the lock is released, so queries are
+//				  not held up by the fsync
+//  INPUT:        Parameters:	follower - pointer to follower
+//								batch - integers being added (emptied)
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  InsertBatch, LogOffset, CommitLog
+//*****************************************************************************
+
+void ApplyFollowBatch (fileFollower *follower, vector<int>& batch)
+{
+	if (batch.empty())
+	{
+		return;
+	}
+	
+	{
+		lock_guard<shared_mutex> guard (follower->tree->lock);
+		bool quiet = follower->tree->quiet;		// server mode keeps the tree quiet
+		
+		// duplicates in followed data are skipped without messages
+		
+		follower->tree->quiet = true;
+		InsertBatch (follower->tree, batch);
+		follower->tree->quiet = quiet;
+		
+		// queued after the integers, so a crash can only repeat them
+		// call LogOffset
+		
+		LogOffset (follower->tree, follower->offset - follower->parser.pendingBytes);
+	}
+	
+	// call CommitLog
+	
+	if (!CommitLog (follower->tree))
+	{
+		cout << endl;
+		cerr << "Error - unable to write " << follower->tree->log->logName
+			 << ", changes are kept and will be retried." << endl;
+	}
+	
+	batch.clear();
+}
+
+//*****************************************************************************
+//  FUNCTION:	  StopFollow
+//  DESCRIPTION:  stops the follow thread and de-allocates the follower
+//  INPUT:        Parameters:	follower - pointer to follower
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void StopFollow (fileFollower *follower)
+{
+	follower->stop = true;
+	follower->worker.join();
+	delete follower;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  RangeKeys
+//  DESCRIPTION:  lists integers between two bounds in ascending order
+//  INPUT:        Parameters:	newTree - pointer to new binary tree
+//								low, high - inclusive bounds
+//								keys - receives the integers
+//								limit - most integers to list
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  RangeNodes, FindContainer, ContainerValues
+//*****************************************************************************
+
+void RangeKeys (binaryTree *newTree, int low, int high, vector<int>& keys, int limit)
+{
+	vector<uint16_t> lows;		// members of the current container
+	int base;					// upper 16 bits of the current container
+	int value;					// current member
+	
+	keys.clear();
+	
+	// pointer tree - call RangeNodes
+	
+	if (newTree->set == NULL)
+	{
+		RangeNodes (newTree->root, low, high, keys, limit);
+		return;
+	}
+	
+	// compressed set - walk containers from the one holding low
+	
+	for (int c = FindContainer (newTree->set, (uint32_t(low) ^ SET_SIGN_BIT) >> 16);
+		 c < (int)newTree->set->containers.size() && (int)keys.size() < limit; c++)
+	{
+		base = int((uint32_t(newTree->set->containers[c].high) << 16) ^ SET_SIGN_BIT);
+		
+		if (base > high)
+		{
+			break;
+		}
+		
+		ContainerValues (newTree->set->containers[c], lows);
+		
+		for (int i = 0; i < (int)lows.size() && (int)keys.size() < limit; i++)
+		{
+			value = base | lows[i];
+			
+			if (value >= low && value <= high)
+			{
+				keys.push_back (value);
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  RangeNodes
+//  DESCRIPTION:  lists integers of a subtree between two bounds in order,
+//				  skipping subtrees outside the bounds; only nodes not
+//				  below low are pushed on the path, and the walk stops at
+//				  the first integer above high or at the limit
+//  INPUT:        Parameters:	root - pointer to subtree root
+//								low, high - inclusive bounds
+//								keys - receives the integers
+//								limit - most integers to list
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void RangeNodes (node* root, int low, int high, vector<int>& keys, int limit)
+{
+	vector<node*> path;		// nodes not below low, not yet listed
+	node *current = root;	// subtree being descended
+	
+	while ((current != NULL || !path.empty()) && (int)keys.size() < limit)
+	{
+		// descend to the smallest integer not below low
+		
+		while (current != NULL)
+		{
+			if (current->num < low)
+			{
+				current = current->right;
+			}
+			
+			else
+			{
+				path.push_back (current);
+				current = current->left;
+			}
+		}
+		
+		// nothing left that is not below low, or every integer still to be
+		// listed is above high
+		
+		if (path.empty() || path.back()->num > high)
+		{
+			break;
+		}
+		
+		current = path.back();
+		path.pop_back();
+		
+		keys.push_back (current->num);
+		current = current->right;
+	}
+}
+
+#ifdef __linux__
+
+// set by SIGINT / SIGTERM to stop the server
+
+volatile sig_atomic_t serverStop = 0;
+
+//*****************************************************************************
+//  FUNCTION:	  StopServer
+//  DESCRIPTION:  signal handler - asks the server loop to stop
+//  INPUT:        Parameters:	signum - signal number
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void StopServer (int signum)
+{
+	(void)signum;
+	serverStop = 1;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  OpenSocket
+//  DESCRIPTION:  creates a listening or connected socket; an address made
+//				  of digits is a localhost TCP port, anything else is a
+//				  Unix domain socket path
+//  INPUT:        Parameters:	address - port number or socket path
+//								listening - true (bind and listen)
+//											false (connect)
+//  OUTPUT: 	  Return value: socket descriptor
+//								-1 - socket could not be opened
+//  CALLS TO:	  none
+//*****************************************************************************
+
+int OpenSocket (const string& address, bool listening)
+{
+	sockaddr_un local;		// Unix domain address
+	sockaddr_in inet;		// localhost TCP address
+	sockaddr *target;		// address in use
+	socklen_t length;		// size of address in use
+	bool tcp = !address.empty()
+			   && address.find_first_not_of ("0123456789") == string::npos;
+	int one = 1;			// socket option value
+	int fd;					// socket descriptor
+	
+	if (tcp)
+	{
+		memset (&inet, 0, sizeof (inet));
+		inet.sin_family = AF_INET;
+		inet.sin_port = htons (atoi (address.c_str()));
+		inet.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+		target = (sockaddr*)&inet;
+		length = sizeof (inet);
+	}
+	
+	else
+	{
+		if (address.size() >= sizeof (local.sun_path))
+		{
+			return -1;
+		}
+		
+		memset (&local, 0, sizeof (local));
+		local.sun_family = AF_UNIX;
+		strcpy (local.sun_path, address.c_str());
+		target = (sockaddr*)&local;
+		length = sizeof (local);
+	}
+	
+	fd = socket (tcp ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	
+	if (fd < 0)
+	{
+		return -1;
+	}
+	
+	if (tcp)
+	{
+		setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+	}
+	
+	// client - connect
+	
+	if (!listening)
+	{
+		if (connect (fd, target, length) < 0)
+		{
+			close (fd);
+			return -1;
+		}
+		
+		return fd;
+	}
+	
+	// server - replace a stale socket file, then bind and listen
+	
+	if (tcp)
+	{
+		setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+	}
+	
+	else
+	{
+		unlink (address.c_str());
+	}
+	
+	if (bind (fd, target, length) < 0 || listen (fd, SOMAXCONN) < 0)
+	{
+		close (fd);
+		return -1;
+	}
+	
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+	
+	return fd;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ServeRequests
+//  DESCRIPTION:  serves tree requests until SIGINT or SIGTERM; an epoll
+//				  loop reads pipelined requests and writes responses, and a
+//				  worker pool executes each connection's requests in batches
+//  INPUT:        Parameters:	newTree - pointer to loaded binary tree
+//								opts - command line options
+//  OUTPUT: 	  Return value: 0 - server stopped
+//								1 - server could not be started
+//  CALLS TO:	  OpenSocket, ServerWorker, AcceptConns, ReadConn,
+//				  FlushConn, ServiceConn, CloseConn, ReapConns
+//*****************************************************************************
+
+int ServeRequests (binaryTree *newTree, options& opts)
+{
+	requestServer server;					// server state
+	epoll_event events[SERVER_EVENTS];		// ready descriptors
+	epoll_event watch;						// descriptor registration
+	vector<serverJob*> finished;			// batches returned by workers
+	uint64_t wakeups;						// drained eventfd counter
+	int ready;								// number of ready descriptors
+	
+	server.tree = newTree;
+	server.stopping = false;
+	server.listenFd = OpenSocket (opts.address, true);
+	server.epollFd = epoll_create1 (EPOLL_CLOEXEC);
+	server.wakeFd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	
+	if (server.listenFd < 0 || server.epollFd < 0 || server.wakeFd < 0)
+	{
+		cout << endl;
+		cerr << "Error - unable to serve on " << opts.address << endl;
+		return 1;
+	}
+	
+	// register listening socket and worker wakeups
+	// data.ptr identifies the descriptor, sentinels for the two fixed ones
+	
+	watch.events = EPOLLIN;
+	watch.data.ptr = &server.listenFd;
+	epoll_ctl (server.epollFd, EPOLL_CTL_ADD, server.listenFd, &watch);
+	watch.data.ptr = &server.wakeFd;
+	epoll_ctl (server.epollFd, EPOLL_CTL_ADD, server.wakeFd, &watch);
+	
+	signal (SIGINT, StopServer);
+	signal (SIGTERM, StopServer);
+	signal (SIGPIPE, SIG_IGN);
+	
+	// requests from clients never print per-integer messages
+	
+	{
+		lock_guard<shared_mutex> guard (newTree->lock);
+		newTree->quiet = true;
+	}
+	
+	// start the worker pool
+	
+	for (int i = 0; i < opts.workers; i++)
+	{
+		server.workers.push_back (thread (ServerWorker, &server));
+	}
+	
+	cout << endl;
+	cout << "Serving " << newTree->count << " integers on " << opts.address
+		 << " with " << opts.workers << " workers, press Ctrl+C to stop." << endl;
+	
+	while (!serverStop)
+	{
+		ready = epoll_wait (server.epollFd, events, SERVER_EVENTS, FOLLOW_POLL_MS);
+		
+		// free connections closed in the previous pass
+		
+		ReapConns (&server);
+		
+		for (int i = 0; i < ready; i++)
+		{
+			// new connections
+			
+			if (events[i].data.ptr == &server.listenFd)
+			{
+				AcceptConns (&server);
+			}
+			
+			// batches finished by workers - queue responses, dispatch more
+			
+			else if (events[i].data.ptr == &server.wakeFd)
+			{
+				while (read (server.wakeFd, &wakeups, sizeof (wakeups)) > 0)
+				{
+				}
+				
+				{
+					lock_guard<mutex> guard (server.doneLock);
+					finished.swap (server.done);
+				}
+				
+				for (int j = 0; j < (int)finished.size(); j++)
+				{
+					serverConn *conn = finished[j]->conn;
+					
+					conn->output.insert (conn->output.end(), finished[j]->responses.begin(),
+										 finished[j]->responses.end());
+					conn->busy = false;
+					delete finished[j];
+					
+					if (conn->closed || !FlushConn (conn))
+					{
+						CloseConn (&server, conn);
+					}
+					
+					else
+					{
+						ServiceConn (&server, conn);
+					}
+				}
+				
+				finished.clear();
+			}
+			
+			// client connection
+			
+			else
+			{
+				serverConn *conn = (serverConn*)events[i].data.ptr;
+				bool open = true;
+				
+				// closed earlier in this pass
+				
+				if (conn->closed)
+				{
+					continue;
+				}
+				
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				{
+					open = ReadConn (conn);
+				}
+				
+				if (open && (events[i].events & EPOLLOUT))
+				{
+					open = FlushConn (conn);
+				}
+				
+				if (!open)
+				{
+					CloseConn (&server, conn);
+				}
+				
+				else
+				{
+					ServiceConn (&server, conn);
+				}
+			}
+		}
+	}
+	
+	// stop the worker pool and close every connection
+	
+	{
+		lock_guard<mutex> guard (server.queueLock);
+		server.stopping = true;
+	}
+	
+	server.queueReady.notify_all();
+	
+	for (int i = 0; i < (int)server.workers.size(); i++)
+	{
+		server.workers[i].join();
+	}
+	
+	for (int i = 0; i < (int)server.done.size(); i++)
+	{
+		server.done[i]->conn->busy = false;
+		delete server.done[i];
+	}
+	
+	for (int i = 0; i < (int)server.jobs.size(); i++)
+	{
+		server.jobs[i]->conn->busy = false;
+		delete server.jobs[i];
+	}
+	
+	for (set<serverConn*>::iterator it = server.conns.begin(); it != server.conns.end(); it++)
+	{
+		CloseConn (&server, *it);
+	}
+	
+	ReapConns (&server);
+	
+	{
+		lock_guard<shared_mutex> guard (newTree->lock);
+		newTree->quiet = false;
+	}
+	
+	close (server.listenFd);
+	close (server.wakeFd);
+	close (server.epollFd);
+	
+	if (opts.address.find_first_not_of ("0123456789") != string::npos)
+	{
+		unlink (opts.address.c_str());
+	}
+	
+	cout << endl;
+	cout << "Server stopped." << endl;
+	
+	return 0;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  AcceptConns
+//  DESCRIPTION:  accepts all pending connections and registers them
+//  INPUT:        Parameters:	server - pointer to server state
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void AcceptConns (requestServer *server)
+{
+	epoll_event watch;		// descriptor registration
+	serverConn *conn;		// new connection
+	int one = 1;			// socket option value
+	int fd;					// accepted descriptor
+	
+	while ((fd = accept4 (server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+	{
+		setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+		
+		conn = new serverConn;
+		conn->fd = fd;
+		conn->sent = 0;
+		conn->busy = false;
+		conn->closed = false;
+		conn->writing = false;
+		conn->peerDone = false;
+		conn->events = EPOLLIN;
+		server->conns.insert (conn);
+		
+		watch.events = EPOLLIN;
+		watch.data.ptr = conn;
+		epoll_ctl (server->epollFd, EPOLL_CTL_ADD, fd, &watch);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ReadConn
+//  DESCRIPTION:  appends the bytes available on a connection to its input,
+//				  up to MAX_CONN_INPUT; the rest waits in the socket buffer
+//  INPUT:        Parameters:	conn - pointer to connection
+//  OUTPUT: 	  Return value: true (connection open, or peer finished
+//									  sending and awaits its responses)
+//								false (error)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool ReadConn (serverConn *conn)
+{
+	unsigned char buffer[READ_CHUNK_BYTES];		// received bytes
+	ssize_t got;								// bytes received
+	
+	while (conn->input.size() < (size_t)MAX_CONN_INPUT)
+	{
+		got = recv (conn->fd, buffer, min (sizeof (buffer), MAX_CONN_INPUT - conn->input.size()), 0);
+		
+		// peer finished sending - its requests are still answered
+		
+		if (got == 0)
+		{
+			conn->peerDone = true;
+			return true;
+		}
+		
+		if (got < 0)
+		{
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+		
+		conn->input.insert (conn->input.end(), buffer, buffer + got);
+	}
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DispatchConn
+//  DESCRIPTION:  hands the complete requests of an idle connection to the
+//				  worker pool as one batch; one batch per connection is in
+//				  flight at a time so responses keep request order, and
+//				  none while earlier responses wait for socket space
+//  INPUT:        Parameters:	server - pointer to server state
+//								conn - pointer to connection
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void DispatchConn (requestServer *server, serverConn *conn)
+{
+	serverJob *job;			// batch for the worker pool
+	size_t complete;		// bytes of complete requests in the batch
+	
+	complete = min (conn->input.size() / REQUEST_BYTES, (size_t)MAX_BATCH_REQUESTS)
+			   * REQUEST_BYTES;
+	
+	if (conn->busy || conn->closed || conn->writing || complete == 0)
+	{
+		return;
+	}
+	
+	job = new serverJob;
+	job->conn = conn;
+	job->requests.assign (conn->input.begin(), conn->input.begin() + complete);
+	conn->input.erase (conn->input.begin(), conn->input.begin() + complete);
+	conn->busy = true;
+	
+	{
+		lock_guard<mutex> guard (server->queueLock);
+		server->jobs.push_back (job);
+	}
+	
+	server->queueReady.notify_one();
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FlushConn
+//  DESCRIPTION:  sends queued responses; the connection is marked as
+//				  writing while the socket buffer is full
+//  INPUT:        Parameters:	conn - pointer to connection
+//  OUTPUT: 	  Return value: true (connection open)
+//								false (send failed)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool FlushConn (serverConn *conn)
+{
+	ssize_t put;			// bytes sent
+	bool blocked = false;	// socket buffer is full
+	
+	while (conn->sent < conn->output.size())
+	{
+		put = send (conn->fd, &conn->output[conn->sent], conn->output.size() - conn->sent,
+					MSG_NOSIGNAL);
+		
+		if (put < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				blocked = true;
+				break;
+			}
+			
+			if (errno != EINTR)
+			{
+				return false;
+			}
+		}
+		
+		else
+		{
+			conn->sent += put;
+		}
+	}
+	
+	if (!blocked)
+	{
+		conn->output.clear();
+		conn->sent = 0;
+	}
+	
+	conn->writing = blocked;
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ServiceConn
+//  DESCRIPTION:  dispatches a connection's requests, closes it once a
+//				  half-closed peer has all its responses, and otherwise
+//				  updates the events it waits for; requests are not read
+//				  while responses wait for socket space or the input is
+//				  full, so a client that does not read cannot grow either
+//  INPUT:        Parameters:	server - pointer to server state
+//								conn - pointer to connection
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  DispatchConn, CloseConn
+//*****************************************************************************
+
+void ServiceConn (requestServer *server, serverConn *conn)
+{
+	epoll_event watch;		// descriptor registration
+	unsigned events = 0;	// events the connection waits for
+	
+	// call DispatchConn
+	
+	DispatchConn (server, conn);
+	
+	// peer finished sending and every response is sent - call CloseConn
+	
+	if (conn->peerDone && !conn->busy && !conn->writing
+		&& conn->input.size() < (size_t)REQUEST_BYTES)
+	{
+		CloseConn (server, conn);
+		return;
+	}
+	
+	if (!conn->peerDone && !conn->writing && conn->input.size() < (size_t)MAX_CONN_INPUT)
+	{
+		events |= EPOLLIN;
+	}
+	
+	if (conn->writing)
+	{
+		events |= EPOLLOUT;
+	}
+	
+	if (events != conn->events)
+	{
+		conn->events = events;
+		watch.events = events;
+		watch.data.ptr = conn;
+		epoll_ctl (server->epollFd, EPOLL_CTL_MOD, conn->fd, &watch);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CloseConn
+//  DESCRIPTION:  closes a connection's socket; the connection itself is
+//				  freed by ReapConns once no batch is at the worker pool
+//  INPUT:        Parameters:	server - pointer to server state
+//								conn - pointer to connection
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void CloseConn (requestServer *server, serverConn *conn)
+{
+	conn->closed = true;
+	
+	if (conn->fd >= 0)
+	{
+		epoll_ctl (server->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+		close (conn->fd);
+		conn->fd = -1;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ReapConns
+//  DESCRIPTION:  frees closed connections that have no batch in flight
+//  INPUT:        Parameters:	server - pointer to server state
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void ReapConns (requestServer *server)
+{
+	set<serverConn*>::iterator it = server->conns.begin();	// current connection
+	
+	while (it != server->conns.end())
+	{
+		if ((*it)->closed && !(*it)->busy)
+		{
+			delete *it;
+			server->conns.erase (it++);
+		}
+		
+		else
+		{
+			it++;
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ServerWorker
+//  DESCRIPTION:  worker thread - executes queued batches and returns them
+//				  to the event loop
+//  INPUT:        Parameters:	server - pointer to server state
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ExecuteBatch
+//*****************************************************************************
+
+void ServerWorker (requestServer *server)
+{
+	serverJob *job;			// batch being executed
+	uint64_t one = 1;		// eventfd increment
+	
+	while (true)
+	{
+		{
+			unique_lock<mutex> guard (server->queueLock);
+			
+			while (server->jobs.empty() && !server->stopping)
+			{
+				server->queueReady.wait (guard);
+			}
+			
+			if (server->stopping)
+			{
+				return;
+			}
+			
+			job = server->jobs.front();
+			server->jobs.pop_front();
+		}
+		
+		// call ExecuteBatch
+		
+		ExecuteBatch (server->tree, job);
+		
+		{
+			lock_guard<mutex> guard (server->doneLock);
+			server->done.push_back (job);
+		}
+		
+		if (write (server->wakeFd, &one, sizeof (one)) < 0)
+		{
+			// counter is saturated - the loop is already being woken
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ExecuteBatch
+//  DESCRIPTION:  executes a batch of requests under a single tree lock and
+//				  encodes their responses; batches of finds and ranges take
+//				  the lock shared, so workers serve them in parallel, and
+//				  logged changes share one commit made after the lock is
+//				  released (batches without inserts or deletes skip it)
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								job - batch of requests
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  InsertNode, FindNode, DeleteKey, RangeKeys, CommitLog,
+//				  DecodeNum, EncodeNum
+//*****************************************************************************
+
+void ExecuteBatch (binaryTree *newTree, serverJob *job)
+{
+	const unsigned char *request;		// current request
+	unsigned char header[RESPONSE_BYTES];	// status and integer count
+	unsigned char bytes[4];				// encoded integer
+	vector<int> keys;					// range results
+	int num;							// request integer
+	int before;							// count before an insert
+	unsigned char status;				// response status
+	bool reading;						// batch only reads the tree
+	bool changing = false;				// batch has inserts or deletes
+	shared_lock<shared_mutex> readGuard (newTree->lock, defer_lock);	// shared tree lock
+	unique_lock<shared_mutex> writeGuard (newTree->lock, defer_lock);	// exclusive tree lock
+	
+	// finds update the hot-key cache, so only an uncached tree can be
+	// read by several batches at once
+	
+	reading = (newTree->cache == NULL);
+	
+	for (size_t at = 0; at < job->requests.size(); at += REQUEST_BYTES)
+	{
+		changing = changing || job->requests[at] == 'I' || job->requests[at] == 'D';
+	}
+	
+	reading = reading && !changing;
+	
+	if (reading)
+	{
+		readGuard.lock();
+	}
+	
+	else
+	{
+		writeGuard.lock();
+	}
+	
+	for (size_t at = 0; at < job->requests.size(); at += REQUEST_BYTES)
+	{
+		request = &job->requests[at];
+		num = DecodeNum (request + 1);
+		keys.clear();
+		status = STATUS_OK;
+		
+		switch (request[0])
+		{
+			// same rule as ValidateNum - positive, non-zero integers
+			
+			case 'I':
+				if (num <= 0)
+				{
+					status = STATUS_BAD_REQUEST;
+					break;
+				}
+				
+				before = newTree->count;
+				InsertNode (newTree, num);
+				
+				// not added and not already present - refused at the memory limit
+				
+				if (newTree->count > before)
+				{
+					status = STATUS_OK;
+				}
+				
+				else
+				{
+					status = FindNode (newTree, num) ? STATUS_MISSING : STATUS_NO_ROOM;
+				}
+				
+				break;
+			
+			case 'F':
+				status = FindNode (newTree, num) ? STATUS_OK : STATUS_MISSING;
+				break;
+			
+			case 'D':
+				status = DeleteKey (newTree, num) ? STATUS_OK : STATUS_MISSING;
+				break;
+			
+			case 'R':
+				RangeKeys (newTree, num, DecodeNum (request + 5), keys, MAX_RANGE_KEYS);
+				break;
+			
+			default:
+				status = STATUS_BAD_REQUEST;
+		}
+		
+		header[0] = status;
+		EncodeNum (keys.size(), header + 1);
+		job->responses.insert (job->responses.end(), header, header + RESPONSE_BYTES);
+		
+		for (int i = 0; i < (int)keys.size(); i++)
+		{
+			EncodeNum (keys[i], bytes);
+			job->responses.insert (job->responses.end(), bytes, bytes + 4);
+		}
+	}
+	
+	// release the tree before the commit - call CommitLog
+	
+	if (reading)
+	{
+		readGuard.unlock();
+	}
+	
+	else
+	{
+		writeGuard.unlock();
+	}
+	
+	if (changing && !CommitLog (newTree))
+	{
+		cout << endl;
+		cerr << "Error - unable to write " << newTree->log->logName
+			 << ", changes are kept and will be retried." << endl;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  RunClient
+//  DESCRIPTION:  load generator - drives the server from several
+//				  connections with pipelined windows of requests and
+//				  reports throughput and latency percentiles
+//  INPUT:        Parameters:	opts - command line options
+//  OUTPUT: 	  Return value: 0 - run completed
+//								1 - server could not be reached
+//  CALLS TO:	  ClientConnection
+//*****************************************************************************
+
+int RunClient (options& opts)
+{
+	vector<thread> clients;				// one thread per connection
+	vector<double> latencies;			// per-request latency (microseconds)
+	mutex resultLock;					// guards latencies and failures
+	int failures = 0;					// connections that failed
+	double seconds;						// wall time of the run
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	
+	for (int i = 0; i < opts.connections; i++)
+	{
+		clients.push_back (thread (ClientConnection, &opts, i, &latencies,
+								   &resultLock, &failures));
+	}
+	
+	for (int i = 0; i < (int)clients.size(); i++)
+	{
+		clients[i].join();
+	}
+	
+	seconds = chrono::duration<double> (chrono::steady_clock::now() - start).count();
+	
+	if (latencies.empty())
+	{
+		cerr << "Error - unable to reach server on " << opts.address << endl;
+		return 1;
+	}
+	
+	sort (latencies.begin(), latencies.end());
+	
+	cout << "Load generator: " << opts.connections << " connections, pipeline depth "
+		 << opts.depth << ", " << latencies.size() << " requests";
+	
+	if (failures > 0)
+	{
+		cout << " (" << failures << " connections failed)";
+	}
+	
+	cout << endl << endl;
+	cout << fixed << setprecision(1);
+	cout << "Throughput:   " << latencies.size() / seconds << " requests/s" << endl;
+	cout << "Latency p50:  " << latencies[latencies.size() * 50 / 100] << " us" << endl;
+	cout << "Latency p99:  " << latencies[latencies.size() * 99 / 100] << " us" << endl;
+	cout << "Latency p999: " << latencies[latencies.size() * 999 / 1000] << " us" << endl;
+	cout << "Latency max:  " << latencies.back() << " us" << endl;
+	
+	return 0;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ClientConnection
+//  DESCRIPTION:  load generator thread - sends windows of requests (80%
+//				  find, 10% insert, 9% delete, 1% range) and times each
+//				  request from the window send to its response
+//  INPUT:        Parameters:	opts - command line options
+//								index - connection number (random seed)
+//								latencies - receives request latencies
+//								resultLock - guards latencies and failures
+//								failures - incremented if the connection fails
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  OpenSocket, EncodeNum, DecodeNum
+//*****************************************************************************
+
+void ClientConnection (options *opts, int index, vector<double> *latencies,
+					   mutex *resultLock, int *failures)
+{
+	mt19937 random (index + 1);					// request mix
+	vector<unsigned char> window;				// encoded requests
+	vector<unsigned char> input;				// received bytes
+	vector<double> times;						// latencies of this connection
+	unsigned char buffer[READ_CHUNK_BYTES];		// received block
+	unsigned char request[REQUEST_BYTES];		// encoded request
+	size_t at;									// parse position in input
+	ssize_t moved;								// bytes sent or received
+	int size;									// requests in current window
+	int answered;								// responses parsed
+	int pick;									// request kind
+	int num;									// request integer
+	int fd = OpenSocket (opts->address, false);	// server connection
+	
+	if (fd < 0)
+	{
+		lock_guard<mutex> guard (*resultLock);
+		(*failures)++;
+		return;
+	}
+	
+	times.reserve (opts->requests);
+	
+	for (int sent = 0; sent < opts->requests; sent += size)
+	{
+		size = min (opts->depth, opts->requests - sent);
+		window.clear();
+		
+		for (int i = 0; i < size; i++)
+		{
+			pick = random() % 100;
+			num = random() % CLIENT_KEY_RANGE + 1;
+			request[0] = (pick < 80) ? 'F' : (pick < 90) ? 'I' : (pick < 99) ? 'D' : 'R';
+			EncodeNum (num, request + 1);
+			EncodeNum (num + CLIENT_RANGE_WIDTH, request + 5);
+			window.insert (window.end(), request, request + REQUEST_BYTES);
+		}
+		
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		
+		// send the whole window
+		
+		for (size_t done = 0; done < window.size(); done += moved)
+		{
+			moved = send (fd, &window[done], window.size() - done, MSG_NOSIGNAL);
+			
+			if (moved <= 0)
+			{
+				size = 0;
+				break;
+			}
+		}
+		
+		// parse responses as they arrive
+		
+		input.clear();
+		at = 0;
+		answered = 0;
+		
+		while (answered < size)
+		{
+			if (input.size() - at >= (size_t)RESPONSE_BYTES
+				&& input.size() - at >= RESPONSE_BYTES + 4 * (size_t)DecodeNum (&input[at + 1]))
+			{
+				at += RESPONSE_BYTES + 4 * DecodeNum (&input[at + 1]);
+				times.push_back (chrono::duration<double, micro>
+								 (chrono::steady_clock::now() - start).count());
+				answered++;
+				continue;
+			}
+			
+			moved = recv (fd, buffer, sizeof (buffer), 0);
+			
+			if (moved <= 0)
+			{
+				break;
+			}
+			
+			input.insert (input.end(), buffer, buffer + moved);
+		}
+		
+		if (answered < size || size == 0)
+		{
+			lock_guard<mutex> guard (*resultLock);
+			(*failures)++;
+			break;
+		}
+	}
+	
+	close (fd);
+	
+	lock_guard<mutex> guard (*resultLock);
+	latencies->insert (latencies->end(), times.begin(), times.end());
+}
+
+#else
+
+//*****************************************************************************
+//  FUNCTION:	  ServeRequests / RunClient
+//  DESCRIPTION:  server mode needs epoll and eventfd (Linux only)
+//*****************************************************************************
+
+int ServeRequests (binaryTree*, options&)
+{
+	cerr << "Error - server mode is only available on Linux." << endl;
+	return 1;
+}
+
+int RunClient (options&)
+{
+	cerr << "Error - client mode is only available on Linux." << endl;
+	return 1;
+}
+
+#endif
+
+//*****************************************************************************
+//  FUNCTION:	  ParseBytes
+//  DESCRIPTION:  reads a byte count with an optional K, M or G suffix
+//  INPUT:        Parameters:	text - option value
+//								bytes - receives the byte count
+//  OUTPUT: 	  Return value: true (valid byte count) / false (invalid
+//								or too large for a long long)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool ParseBytes (const string& text, long long& bytes)
+{
+	char *end;			// first character after the number
+	int scale = 0;		// powers of 1024 in the suffix
+	
+	errno = 0;
+	bytes = strtoll (text.c_str(), &end, 10);
+	
+	if (text.empty() || errno == ERANGE || bytes <= 0)
+	{
+		return false;
+	}
+	
+	switch (toupper (*end))
+	{
+		case 'G':
+			scale++;
+			// fall through
+		case 'M':
+			scale++;
+			// fall through
+		case 'K':
+			scale++;
+			end++;
+	}
+	
+	for (int i = 0; i < scale; i++)
+	{
+		if (bytes > LLONG_MAX / 1024)
+		{
+			return false;
+		}
+		
+		bytes *= 1024;
+	}
+	
+	return *end == '\0';
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BlockBytes
+//  DESCRIPTION:  finds the bytes the allocator reserved for a block,
+//				  including its header; glibc reports the usable size,
+//				  other allocators are assumed to round to 16 bytes
+//  INPUT:        Parameters:	block - allocated block (NULL - none)
+//								size - bytes requested for the block
+//  OUTPUT: 	  Return value: bytes reserved for the block
+//  CALLS TO:	  none
+//*****************************************************************************
+
+long long BlockBytes (const void* block, size_t size)
+{
+	if (block == NULL)
+	{
+		return 0;
+	}
+	
+#ifdef __GLIBC__
+	(void)size;
+	return malloc_usable_size ((void*)block) + sizeof (size_t);
+#else
+	return (size + sizeof (size_t) + 15) / 16 * 16;
+#endif
+}
+
+//*****************************************************************************
+//  FUNCTION:	  NodeCost
+//  DESCRIPTION:  finds the bytes reserved for one pointer tree node
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: bytes per node, allocator overhead included
+//  CALLS TO:	  CreateNode, BlockBytes
+//*****************************************************************************
+
+long long NodeCost()
+{
+	static const long long cost = [] 
+	{
+		node *probe = CreateNode (0);		// node measured once
+		long long bytes = BlockBytes (probe, sizeof (node));
+		
+		delete probe;
+		return bytes;
+	}();
+	
+	return cost;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  MeasureMemory
+//  DESCRIPTION:  adds up the memory used by the tree, the compressed set,
+//				  the hot-key cache and the queued log records
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								usage - receives the byte counts
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  NodeMemory, BlockBytes
+//*****************************************************************************
+
+void MeasureMemory (binaryTree *newTree, memoryUsage& usage)
+{
+	usage.nodes = 0;
+	usage.nodeBytes = 0;
+	usage.setBytes = 0;
+	usage.cacheBytes = 0;
+	usage.logBytes = 0;
+	usage.overheadBytes = BlockBytes (newTree, sizeof (binaryTree)) - sizeof (binaryTree);
+	usage.heapBytes = 0;
+	usage.heapFreeBytes = 0;
+	
+	// call NodeMemory
+	
+	NodeMemory (newTree->root, usage);
+	
+	// compressed set - the set, its container array and each container's
+	// values or bitmap
+	
+	if (newTree->set != NULL)
+	{
+		const vector<setContainer>& containers = newTree->set->containers;
+		
+		usage.setBytes += sizeof (intSet) + containers.capacity() * sizeof (setContainer);
+		usage.overheadBytes += BlockBytes (newTree->set, sizeof (intSet)) - sizeof (intSet)
+							   + BlockBytes (containers.data(), containers.capacity() * sizeof (setContainer))
+							   - containers.capacity() * sizeof (setContainer);
+		
+		for (size_t i = 0; i < containers.size(); i++)
+		{
+			size_t values = containers[i].values.capacity() * sizeof (uint16_t);
+			size_t bits = containers[i].bits.capacity() * sizeof (uint64_t);
+			
+			usage.setBytes += values + bits;
+			usage.overheadBytes += BlockBytes (containers[i].values.data(), values) - values
+								   + BlockBytes (containers[i].bits.data(), bits) - bits;
+		}
+	}
+	
+	if (newTree->cache != NULL)
+	{
+		usage.cacheBytes = sizeof (hotCache);
+		usage.overheadBytes += BlockBytes (newTree->cache, sizeof (hotCache)) - sizeof (hotCache);
+	}
+	
+	if (newTree->log != NULL)
+	{
+		size_t pending = newTree->log->pending.capacity();
+		
+		usage.logBytes = sizeof (opLog) + pending;
+		usage.overheadBytes += BlockBytes (newTree->log, sizeof (opLog)) - sizeof (opLog)
+							   + BlockBytes (newTree->log->pending.data(), pending) - pending;
+	}
+	
+	usage.totalBytes = sizeof (binaryTree) + usage.nodeBytes + usage.setBytes
+					   + usage.cacheBytes + usage.logBytes + usage.overheadBytes;
+	
+	// whole process heap - free bytes held by the allocator are lost
+	// to fragmentation until they are reused
+	
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 heap = mallinfo2();
+	
+	usage.heapBytes = heap.arena + heap.hblkhd;
+	usage.heapFreeBytes = heap.fordblks;
+#endif
+#endif
+}
+
+//*****************************************************************************
+//  FUNCTION:	  NodeMemory
+//  DESCRIPTION:  adds up the memory used by a subtree; the order nodes are
+//				  visited in does not matter, so unvisited subtrees are
+//				  simply kept in a vector
+//  INPUT:        Parameters:	root - root of subtree
+//								usage - receives the byte counts
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  BlockBytes
+//*****************************************************************************
+
+void NodeMemory (node* root, memoryUsage& usage)
+{
+	vector<node*> pending;		// subtrees not yet visited
+	node *current;				// node being measured
+	
+	if (root != NULL)
+	{
+		pending.push_back (root);
+	}
+	
+	while (!pending.empty())
+	{
+		current = pending.back();
+		pending.pop_back();
+		
+		usage.nodes++;
+		usage.nodeBytes += sizeof (node);
+		usage.overheadBytes += BlockBytes (current, sizeof (node)) - sizeof (node);
+		
+		if (current->left != NULL)
+		{
+			pending.push_back (current->left);
+		}
+		
+		if (current->right != NULL)
+		{
+			pending.push_back (current->right);
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FootprintBytes
+//  DESCRIPTION:  estimates the memory used by the tree without visiting
+//				  every node; used to enforce the memory limit
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//  OUTPUT: 	  Return value: bytes used, allocator overhead included
+//  CALLS TO:	  MeasureMemory, NodeCost, BlockBytes
+//*****************************************************************************
+
+long long FootprintBytes (binaryTree *newTree)
+{
+	memoryUsage usage;		// compressed set is measured exactly
+	
+	if (newTree->set != NULL)
+	{
+		MeasureMemory (newTree, usage);
+		return usage.totalBytes;
+	}
+	
+	return (long long)newTree->count * NodeCost()
+		   + BlockBytes (newTree, sizeof (binaryTree))
+		   + BlockBytes (newTree->cache, sizeof (hotCache));
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BudgetRoom
+//  DESCRIPTION:  finds how many new nodes fit under the memory limit;
+//				  the tree is measured again only once the room found by
+//				  the last measurement is used up (deletes only add room);
+//				  with the compact policy, a pointer tree that is out of
+//				  room is first converted to the compressed set; the
+//				  compressed set is budgeted per integer by SetInsertLimit
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								adding - integers about to be inserted
+//  OUTPUT: 	  Return value: integers that may be inserted (0 - adding)
+//  CALLS TO:	  FootprintBytes, NodeCost, CompactTree
+//*****************************************************************************
+
+int BudgetRoom (binaryTree *newTree, int adding)
+{
+	long long cost = NodeCost();	// bytes per node
+	int fit;						// integers that may be inserted
+	
+	if (newTree->maxBytes == 0 || adding <= 0 || newTree->set != NULL)
+	{
+		return adding;
+	}
+	
+	if (newTree->roomLeft < adding * cost)
+	{
+		newTree->roomLeft = newTree->maxBytes - FootprintBytes (newTree);
+		
+		// compact policy - call CompactTree; a set that would not fit
+		// is not tried again, the limit then refuses inserts
+		
+		if (newTree->roomLeft < adding * cost && newTree->compactOnLimit)
+		{
+			if (CompactTree (newTree))
+			{
+				newTree->roomLeft = newTree->maxBytes - FootprintBytes (newTree);
+				return adding;
+			}
+			
+			newTree->compactOnLimit = false;
+		}
+		
+		newTree->roomLeft = max (0LL, newTree->roomLeft);
+	}
+	
+	fit = (int)min ((long long)adding, newTree->roomLeft / cost);
+	newTree->roomLeft -= fit * cost;
+	
+	return fit;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetInsertLimit
+//  DESCRIPTION:  adds an integer to the compressed set under the memory
+//				  limit; the bytes the insert took (a new container, or a
+//				  grown container and container array) are charged to the
+//				  room left, and once that is used up the set is measured
+//				  again and an insert that went over the limit is undone
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//								num - integer being added
+//  OUTPUT: 	  Return value: 1 (added) / 0 (duplicate)
+//								-1 (refused at the memory limit)
+//  CALLS TO:	  SetInsert, SetBytes, FootprintBytes, SetDelete,
+//				  FindContainer, SetOptimizeKey
+//*****************************************************************************
+
+int SetInsertLimit (binaryTree *newTree, int num)
+{
+	intSet *set = newTree->set;		// compressed set
+	uint16_t high = (uint32_t(num) ^ SET_SIGN_BIT) >> 16;	// container key
+	long long before;				// bytes of num's container and the array
+	long long growth;				// bytes the insert took
+	int index;						// container index
+	
+	if (newTree->maxBytes == 0)
+	{
+		return SetInsert (set, num) ? 1 : 0;
+	}
+	
+	before = SetBytes (set, num);
+	
+	if (!SetInsert (set, num))
+	{
+		return 0;
+	}
+	
+	growth = SetBytes (set, num) - before;
+	
+	if (newTree->roomLeft >= growth)
+	{
+		newTree->roomLeft -= growth;
+		return 1;
+	}
+	
+	// room used up - measure again with the insert in place
+	
+	newTree->roomLeft = newTree->maxBytes - FootprintBytes (newTree);
+	
+	if (newTree->roomLeft >= 0)
+	{
+		return 1;
+	}
+	
+	// over the limit - call SetDelete, then hand back the memory the
+	// insert grew (spare array capacity, or an expanded run container)
+	
+	SetDelete (set, num);
+	set->containers.shrink_to_fit();
+	
+	index = FindContainer (set, high);
+	
+	if (index < (int)set->containers.size() && set->containers[index].high == high)
+	{
+		set->containers[index].values.shrink_to_fit();
+		SetOptimizeKey (set, num);
+	}
+	
+	newTree->roomLeft = 0;
+	
+	return -1;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetBytes
+//  DESCRIPTION:  finds the bytes held by the container array of the
+//				  compressed set and by the container an integer belongs to
+//  INPUT:        Parameters:	set - pointer to compressed set
+//								num - integer whose container is measured
+//  OUTPUT: 	  Return value: bytes reserved, allocator overhead included
+//  CALLS TO:	  FindContainer, BlockBytes
+//*****************************************************************************
+
+long long SetBytes (intSet *set, int num)
+{
+	uint16_t high = (uint32_t(num) ^ SET_SIGN_BIT) >> 16;	// container key
+	const vector<setContainer>& containers = set->containers;
+	long long bytes;										// bytes found
+	int index;												// container index
+	
+	bytes = BlockBytes (containers.data(), containers.capacity() * sizeof (setContainer));
+	index = FindContainer (set, high);
+	
+	if (index < (int)containers.size() && containers[index].high == high)
+	{
+		bytes += BlockBytes (containers[index].values.data(),
+							 containers[index].values.capacity() * sizeof (uint16_t))
+				 + BlockBytes (containers[index].bits.data(),
+							   containers[index].bits.capacity() * sizeof (uint64_t));
+	}
+	
+	return bytes;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CompactTree
+//  DESCRIPTION:  moves the integers of the pointer tree into a compressed
+//				  integer set and de-allocates the nodes; sparse integers
+//				  can need more memory in the set than in the tree, so the
+//				  set is built first and kept only if it fits the limit
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//  OUTPUT: 	  Return value: true (switched) / false (set would not fit)
+//  CALLS TO:	  CollectKeys, CreateSet, SetInsert, SetOptimize,
+//				  FootprintBytes, DestroySet, FreeNodes, ClearCache
+//*****************************************************************************
+
+bool CompactTree (binaryTree *newTree)
+{
+	vector<int> keys;		// integers in order
+	node *nodes;			// pointer tree being replaced
+	
+	CollectKeys (newTree, keys);
+	
+	newTree->set = CreateSet();
+	
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		SetInsert (newTree->set, keys[i]);
+	}
+	
+	SetOptimize (newTree->set);
+	
+	// measure the set alone - nodes are not counted while detached
+	
+	nodes = newTree->root;
+	newTree->root = NULL;
+	
+	if (newTree->maxBytes > 0 && FootprintBytes (newTree) > newTree->maxBytes)
+	{
+		DestroySet (newTree->set);
+		newTree->set = NULL;
+		newTree->root = nodes;
+		
+		if (!newTree->quiet)
+		{
+			cout << endl;
+			cout << "Memory limit of " << newTree->maxBytes << " bytes reached - "
+				 << "the compressed integer set would not fit, inserts are refused." << endl;
+		}
+		
+		return false;
+	}
+	
+	FreeNodes (nodes);
+	
+	// cached nodes no longer exist
+	
+	if (newTree->cache != NULL)
+	{
+		ClearCache (newTree->cache);
+	}
+	
+	if (!newTree->quiet)
+	{
+		cout << endl;
+		cout << "Memory limit of " << newTree->maxBytes << " bytes reached - "
+			 << "switched to the compressed integer set";
+		
+		if (!keys.empty())
+		{
+			cout << " (" << keys.size() << " integers moved)";
+		}
+		
+		cout << "." << endl;
+	}
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DisplayMemory
+//  DESCRIPTION:  displays the memory used by the tree
+//  INPUT:        Parameters:	newTree - pointer to binary tree
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  MeasureMemory
+//*****************************************************************************
+
+void DisplayMemory (binaryTree *newTree)
+{
+	memoryUsage usage;		// byte counts
+	
+	MeasureMemory (newTree, usage);
+	
+	cout << endl;
+	cout << "Memory used by the binary search tree:" << endl;
+	cout << left << setw(24) << "  nodes" << right << setw(14) << usage.nodeBytes
+		 << " bytes (" << usage.nodes << " x " << sizeof (node) << ")" << endl;
+	cout << left << setw(24) << "  compressed set" << right << setw(14) << usage.setBytes
+		 << " bytes" << endl;
+	cout << left << setw(24) << "  hot-key cache" << right << setw(14) << usage.cacheBytes
+		 << " bytes" << endl;
+	cout << left << setw(24) << "  operation log" << right << setw(14) << usage.logBytes
+		 << " bytes" << endl;
+	cout << left << setw(24) << "  allocator overhead" << right << setw(14) << usage.overheadBytes
+		 << " bytes" << endl;
+	cout << left << setw(24) << "  total" << right << setw(14) << usage.totalBytes << " bytes";
+	
+	if (newTree->count > 0)
+	{
+		cout << " (" << fixed << setprecision(1) << (double)usage.totalBytes / newTree->count
+			 << " per integer)";
+		cout.unsetf (ios::floatfield);
+		cout.precision (6);
+	}
+	
+	cout << endl;
+	
+	// process heap - not reported by every allocator
+	
+	if (usage.heapBytes > 0)
+	{
+		cout << left << setw(24) << "  process heap" << right << setw(14) << usage.heapBytes
+			 << " bytes (" << usage.heapFreeBytes << " free)" << endl;
+	}
+	
+	if (newTree->maxBytes > 0)
+	{
+		cout << left << setw(24) << "  memory limit" << right << setw(14) << newTree->maxBytes
+			 << " bytes (" << (newTree->compactOnLimit ? "compact" : "reject") << " when reached)" << endl;
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  CreateSet
+//  DESCRIPTION:  allocates an empty compressed integer set
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: set - pointer to new compressed set
+//  CALLS TO:	  none
+//*****************************************************************************
+
+intSet* CreateSet()
+{
+	intSet *set = new intSet;	// pointer to new compressed set
+	
+	return set;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BitCount
+//  DESCRIPTION:  counts the set bits in a bitmap word
+//  INPUT:        Parameters:	word - bitmap word
+//  OUTPUT: 	  Return value: number of set bits
+//  CALLS TO:	  none
+//*****************************************************************************
+
+int BitCount (uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll (word);
+#else
+	int bits = 0;
+	
+	while (word != 0)
+	{
+		word &= word - 1;
+		bits++;
+	}
+	
+	return bits;
+#endif
+}
+
+//*****************************************************************************
+//  FUNCTION:	  LowestBit
+//  DESCRIPTION:  finds the index of the lowest set bit in a non-zero word
+//  INPUT:        Parameters:	word - bitmap word
+//  OUTPUT: 	  Return value: bit index (0 - 63)
+//  CALLS TO:	  BitCount
+//*****************************************************************************
+
+int LowestBit (uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll (word);
+#else
+	return BitCount ((word & (0 - word)) - 1);
+#endif
+}
+
+//*****************************************************************************
+//  FUNCTION:	  FindContainer
+//  DESCRIPTION:  locates the container for a given upper 16 bits
+//  INPUT:        Parameters:	set - pointer to compressed set
+//								high - upper 16 bits of an integer
+//  OUTPUT: 	  Return value: index of the first container not below high
+//  CALLS TO:	  none
+//*****************************************************************************
+
+int FindContainer (intSet *set, uint16_t high)
+{
+	int first = 0;								// search window start
+	int last = set->containers.size();			// search window end
+	int middle;									// window midpoint
+	
+	while (first < last)
+	{
+		middle = first + (last - first) / 2;
+		
+		if (set->containers[middle].high < high)
+		{
+			first = middle + 1;
+		}
+		
+		else
+		{
+			last = middle;
+		}
+	}
+	
+	return first;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ContainerValues
+//  DESCRIPTION:  lists the members of a container in ascending order
+//  INPUT:        Parameters:	chunk - container being listed
+//								lows - receives the low 16 bits of each member
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  LowestBit
+//*****************************************************************************
+
+void ContainerValues (const setContainer& chunk, vector<uint16_t>& lows)
+{
+	uint64_t word;		// remaining bits of a bitmap word
+	
+	lows.clear();
+	lows.reserve (chunk.cardinality);
+	
+	if (chunk.kind == ARRAY_CONTAINER)
+	{
+		lows = chunk.values;
+	}
+	
+	else if (chunk.kind == BITMAP_CONTAINER)
+	{
+		for (int i = 0; i < (int)chunk.bits.size(); i++)
+		{
+			for (word = chunk.bits[i]; word != 0; word &= word - 1)
+			{
+				lows.push_back (i * 64 + LowestBit (word));
+			}
+		}
+	}
+	
+	else
+	{
+		for (int i = 0; i < (int)chunk.values.size(); i += 2)
+		{
+			for (int low = chunk.values[i]; low <= chunk.values[i] + chunk.values[i + 1]; low++)
+			{
+				lows.push_back (low);
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ContainerRebuild
+//  DESCRIPTION:  re-encodes a container as an array or a bitmap, whichever
+//				  the Roaring cardinality threshold selects
+//  INPUT:        Parameters:	chunk - container being re-encoded
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ContainerValues
+//*****************************************************************************
+
+void ContainerRebuild (setContainer& chunk)
+{
+	vector<uint16_t> lows;		// members of the container
+	
+	ContainerValues (chunk, lows);
+	chunk.values.clear();
+	chunk.bits.clear();
+	
+	// sparse - sorted array
+	
+	if (chunk.cardinality <= ARRAY_MAX)
+	{
+		chunk.kind = ARRAY_CONTAINER;
+		chunk.values.swap (lows);
+		chunk.values.shrink_to_fit();
+	}
+	
+	// dense - bitmap
+	
+	else
+	{
+		chunk.kind = BITMAP_CONTAINER;
+		vector<uint16_t>().swap (chunk.values);
+		chunk.bits.assign (BITMAP_WORDS, 0);
+		
+		for (int i = 0; i < (int)lows.size(); i++)
+		{
+			chunk.bits[lows[i] >> 6] |= uint64_t(1) << (lows[i] & 63);
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ContainerFind
+//  DESCRIPTION:  searches for the low 16 bits of an integer in a container
+//  INPUT:        Parameters:	chunk - container being searched
+//								low - low 16 bits of the integer
+//  OUTPUT: 	  Return value: true (if found) / false (if not found)
+//  CALLS TO:	  none
+//*****************************************************************************
+
+bool ContainerFind (const setContainer& chunk, uint16_t low)
+{
+	int first = 0;		// search window start
+	int last;			// search window end
+	int middle;			// window midpoint
+	
+	if (chunk.kind == BITMAP_CONTAINER)
+	{
+		return (chunk.bits[low >> 6] >> (low & 63)) & 1;
+	}
+	
+	if (chunk.kind == ARRAY_CONTAINER)
+	{
+		return binary_search (chunk.values.begin(), chunk.values.end(), low);
+	}
+	
+	// find the last run starting at or before low
+	
+	last = chunk.values.size() / 2;
+	
+	while (first < last)
+	{
+		middle = first + (last - first) / 2;
+		
+		if (chunk.values[2 * middle] <= low)
+		{
+			first = middle + 1;
+		}
+		
+		else
+		{
+			last = middle;
+		}
+	}
+	
+	return first > 0
+		   && low - chunk.values[2 * (first - 1)] <= chunk.values[2 * (first - 1) + 1];
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetInsert
+//  DESCRIPTION:  adds an integer to the compressed set
+//  INPUT:        Parameters:	set - pointer to compressed set
+//								num - integer being added
+//  OUTPUT: 	  Return value: true (if added)
+//								false (if duplicate)
+//  CALLS TO:	  FindContainer, ContainerFind, ContainerRebuild
+//*****************************************************************************
+
+bool SetInsert (intSet *set, int num)
+{
+	uint16_t high = (uint32_t(num) ^ SET_SIGN_BIT) >> 16;	// container key
+	uint16_t low = num & 0xFFFF;			// position within container
+	int index;								// container index
+	setContainer chunk;						// new container
+	
+	// no container yet for these upper bits - add an empty array
+	
+	index = FindContainer (set, high);
+	
+	if (index == (int)set->containers.size() || set->containers[index].high != high)
+	{
+		chunk.high = high;
+		chunk.kind = ARRAY_CONTAINER;
+		chunk.cardinality = 0;
+		set->containers.insert (set->containers.begin() + index, chunk);
+	}
+	
+	setContainer& target = set->containers[index];
+	
+	if (ContainerFind (target, low))
+	{
+		return false;
+	}
+	
+	// runs are only built by SetOptimize - expand before mutating
+	
+	if (target.kind == RUN_CONTAINER)
+	{
+		ContainerRebuild (target);
+	}
+	
+	target.cardinality++;
+	
+	if (target.kind == BITMAP_CONTAINER)
+	{
+		target.bits[low >> 6] |= uint64_t(1) << (low & 63);
+	}
+	
+	else
+	{
+		target.values.insert (lower_bound (target.values.begin(), target.values.end(), low), low);
+		
+		// array outgrew the threshold - switch to bitmap
+		
+		if (target.cardinality > ARRAY_MAX)
+		{
+			ContainerRebuild (target);
+		}
+	}
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetFind
+//  DESCRIPTION:  searches for an integer in the compressed set
+//  INPUT:        Parameters:	set - pointer to compressed set
+//								num - integer being searched for
+//  OUTPUT: 	  Return value: true (if found) / false (if not found)
+//  CALLS TO:	  FindContainer, ContainerFind
+//*****************************************************************************
+
+bool SetFind (intSet *set, int num)
+{
+	uint16_t high = (uint32_t(num) ^ SET_SIGN_BIT) >> 16;	// container key
+	int index;								// container index
+	
+	index = FindContainer (set, high);
+	
+	return index < (int)set->containers.size()
+		   && set->containers[index].high == high
+		   && ContainerFind (set->containers[index], num & 0xFFFF);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetDelete
+//  DESCRIPTION:  removes an integer from the compressed set
+//  INPUT:        Parameters:	set - pointer to compressed set
+//								num - integer being removed
+//  OUTPUT: 	  Return value: true (if removed) / false (if not found)
+//  CALLS TO:	  FindContainer, ContainerFind, ContainerRebuild
+//*****************************************************************************
+
+bool SetDelete (intSet *set, int num)
+{
+	uint16_t high = (uint32_t(num) ^ SET_SIGN_BIT) >> 16;	// container key
+	uint16_t low = num & 0xFFFF;			// position within container
+	int index;								// container index
+	
+	index = FindContainer (set, high);
+	
+	if (index == (int)set->containers.size() || set->containers[index].high != high
+		|| !ContainerFind (set->containers[index], low))
+	{
+		return false;
+	}
+	
+	setContainer& target = set->containers[index];
+	
+	// runs are only built by SetOptimize - expand before mutating
+	
+	if (target.kind == RUN_CONTAINER)
+	{
+		ContainerRebuild (target);
+	}
+	
+	target.cardinality--;
+	
+	// container is now empty - remove it
+	
+	if (target.cardinality == 0)
+	{
+		set->containers.erase (set->containers.begin() + index);
+	}
+	
+	else if (target.kind == BITMAP_CONTAINER)
+	{
+		target.bits[low >> 6] &= ~(uint64_t(1) << (low & 63));
+		
+		// bitmap fell below the threshold - switch to array
+		
+		if (target.cardinality <= ARRAY_MAX)
+		{
+			ContainerRebuild (target);
+		}
+	}
+	
+	else
+	{
+		target.values.erase (lower_bound (target.values.begin(), target.values.end(), low));
+	}
+	
+	return true;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  ContainerOptimize
+//  DESCRIPTION:  converts a container to a run container if runs take
+//				  less memory than its array or bitmap encoding
+//  INPUT:        Parameters:	chunk - container being optimized
+//								lows - scratch list for the container members
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ContainerValues
+//*****************************************************************************
+
+void ContainerOptimize (setContainer& chunk, vector<uint16_t>& lows)
+{
+	int runs;					// number of runs in the container
+	int packedBytes;			// array or bitmap size in bytes
+	
+	if (chunk.kind == RUN_CONTAINER)
+	{
+		return;
+	}
+	
+	ContainerValues (chunk, lows);
+	runs = 0;
+	
+	for (int i = 0; i < (int)lows.size(); i++)
+	{
+		if (i == 0 || lows[i] != lows[i - 1] + 1)
+		{
+			runs++;
+		}
+	}
+	
+	packedBytes = (chunk.kind == ARRAY_CONTAINER) ? 2 * chunk.cardinality
+												  : 8 * BITMAP_WORDS;
+	
+	// runs are not smaller - keep current encoding
+	
+	if (4 * runs >= packedBytes)
+	{
+		return;
+	}
+	
+	chunk.kind = RUN_CONTAINER;
+	chunk.values.clear();
+	vector<uint64_t>().swap (chunk.bits);
+	
+	for (int i = 0; i < (int)lows.size(); i++)
+	{
+		if (i == 0 || lows[i] != lows[i - 1] + 1)
+		{
+			chunk.values.push_back (lows[i]);
+			chunk.values.push_back (0);
+		}
+		
+		else
+		{
+			chunk.values.back()++;
+		}
+	}
+	
+	chunk.values.shrink_to_fit();
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetOptimize
+//  DESCRIPTION:  converts containers to run containers where runs take
+//				  less memory than the array or bitmap encoding
+//  INPUT:        Parameters:	set - pointer to compressed set
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ContainerOptimize
+//*****************************************************************************
+
+void SetOptimize (intSet *set)
+{
+	vector<uint16_t> lows;		// scratch list for container members
+	
+	for (int c = 0; c < (int)set->containers.size(); c++)
+	{
+		ContainerOptimize (set->containers[c], lows);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetOptimizeKey
+//  DESCRIPTION:  converts the container holding an integer to runs where
+//				  smaller; lets a batch re-encode only what it touched
+//  INPUT:        Parameters:	set - pointer to compressed set
+//								num - integer whose container is optimized
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  FindContainer, ContainerOptimize
+//*****************************************************************************
+
+void SetOptimizeKey (intSet *set, int num)
+{
+	uint16_t high = (uint32_t(num) ^ SET_SIGN_BIT) >> 16;	// container key
+	vector<uint16_t> lows;					// scratch list for members
+	int index;								// container index
+	
+	index = FindContainer (set, high);
+	
+	if (index < (int)set->containers.size() && set->containers[index].high == high)
+	{
+		ContainerOptimize (set->containers[index], lows);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  SetDisplay
+//  DESCRIPTION:  displays all integers in the compressed set (in-order)
+//  INPUT:        Parameters:	set - pointer to compressed set
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  ContainerValues
+//*****************************************************************************
+
+void SetDisplay (intSet *set)
+{
+	vector<uint16_t> lows;		// members of the current container
+	int base;					// upper 16 bits of the current container
+	
+	for (int c = 0; c < (int)set->containers.size(); c++)
+	{
+		ContainerValues (set->containers[c], lows);
+		base = int((uint32_t(set->containers[c].high) << 16) ^ SET_SIGN_BIT);
+		
+		for (int i = 0; i < (int)lows.size(); i++)
+		{
+			cout << setw(7) << (base | lows[i]) << " ";
+		}
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  DestroySet
+//  DESCRIPTION:  de-allocates the compressed set
+//  INPUT:        Parameters:	set - pointer to compressed set
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+void DestroySet (intSet *set)
+{
+	delete set;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::BinaryTree
+//  DESCRIPTION:  initializes an empty generic binary tree
+//  INPUT:        Parameters:	compare - key ordering
+//								alloc - allocator for tree nodes
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+BinaryTree<Key, Value, Compare, Allocator>::BinaryTree (const Compare& compare,
+														const Allocator& alloc)
+	: root (NULL), count (0), compare (compare), alloc (alloc)
+{
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::BinaryTree (move)
+//  DESCRIPTION:  takes ownership of another tree's nodes
+//  INPUT:        Parameters:	other - tree being moved from (left empty)
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  none
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+BinaryTree<Key, Value, Compare, Allocator>::BinaryTree (BinaryTree&& other) noexcept
+	: root (other.root), count (other.count),
+	  compare (std::move (other.compare)), alloc (std::move (other.alloc))
+{
+	other.root = NULL;
+	other.count = 0;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::operator=
+//  DESCRIPTION:  frees this tree and takes ownership of another tree's
+//				  nodes; when the allocator does not propagate and the two
+//				  allocators differ, the entries are moved one at a time
+//				  into nodes from this tree's allocator
+//  INPUT:        Parameters:	other - tree being moved from (left empty)
+//  OUTPUT: 	  Return value: reference to this tree
+//  CALLS TO:	  Clear, EmplaceKey
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+BinaryTree<Key, Value, Compare, Allocator>&
+BinaryTree<Key, Value, Compare, Allocator>::operator= (BinaryTree&& other)
+	noexcept (allocator_traits<Allocator>::propagate_on_container_move_assignment::value
+			  || allocator_traits<Allocator>::is_always_equal::value)
+{
+	vector<treeNode*> pending;		// nodes of other still to be moved
+	treeNode *current;				// node being moved
+	
+	if (this == &other)
+	{
+		return *this;
+	}
+	
+	Clear();
+	compare = std::move (other.compare);
+	
+	if constexpr (nodeTraits::propagate_on_container_move_assignment::value)
+	{
+		alloc = std::move (other.alloc);
+	}
+	
+	// same allocator - take the nodes
+	
+	if (nodeTraits::propagate_on_container_move_assignment::value
+		|| nodeTraits::is_always_equal::value || alloc == other.alloc)
+	{
+		root = other.root;
+		count = other.count;
+		other.root = NULL;
+		other.count = 0;
+		return *this;
+	}
+	
+	// different allocators - move the entries (keys are const, so copied)
+	
+	if constexpr (!nodeTraits::propagate_on_container_move_assignment::value
+				  && !nodeTraits::is_always_equal::value)
+	{
+		if (other.root != NULL)
+		{
+			pending.push_back (other.root);
+		}
+		
+		while (!pending.empty())
+		{
+			current = pending.back();
+			pending.pop_back();
+			EmplaceKey (current->entry.first, std::move (current->entry.second));
+			
+			if (current->left != NULL)
+			{
+				pending.push_back (current->left);
+			}
+			
+			if (current->right != NULL)
+			{
+				pending.push_back (current->right);
+			}
+		}
+		
+		other.Clear();
 	}
 	
-	return newTree;
+	return *this;
 }
 
 //*****************************************************************************
-//  FUNCTION:	  IsEmpty
-//  DESCRIPTION:  determines whether the tree is empty or not
-//  INPUT:        Parameters:	root - pointer to root node
-//  OUTPUT: 	  Return value: empty - true (if tree is empty)
-//								   	    false (if tree is not empty)
-//  CALLS TO:	  none
+//  FUNCTION:	  BinaryTree::~BinaryTree
+//  DESCRIPTION:  de-allocates all nodes from the tree
+//  INPUT:        Parameters:	none
+//  OUTPUT: 	  Return value: none
+//  CALLS TO:	  Clear
 //*****************************************************************************
 
-bool IsEmpty (node* root)
+template <class Key, class Value, class Compare, class Allocator>
+BinaryTree<Key, Value, Compare, Allocator>::~BinaryTree()
 {
-	bool empty = true;
-	
-	// root is not NULL - return false
-	
-	if (root != NULL)
-	{
-		empty = false;
-	}
-	
-	return empty;
+	Clear();
 }
 
 //*****************************************************************************
-//  FUNCTION:	  CreateNode
-//  DESCRIPTION:  allocates and fills a new node
-//  INPUT:        Parameters:	num - integer value
-//  OUTPUT: 	  Return value: newNode - pointer to new node
-//								NULL - memory allocation failure
+//  FUNCTION:	  BinaryTree::Less
+//  DESCRIPTION:  orders two keys; integral keys skip the comparator object
+//  INPUT:        Parameters:	a, b - keys being compared
+//  OUTPUT: 	  Return value: true (if a is ordered before b)
 //  CALLS TO:	  none
 //*****************************************************************************
 
-node* CreateNode (int num)
+template <class Key, class Value, class Compare, class Allocator>
+bool BinaryTree<Key, Value, Compare, Allocator>::Less (const Key& a, const Key& b) const
 {
-	node *newNode = new node;	// pointer to new node
-	
-	// memory allocation failure
-	
-	if (newNode == NULL)
+	if constexpr (plainKey)
 	{
-		cout << endl;
-		cerr << "ERROR - memory allocation failure!" << endl;
-		return NULL;
+		return a < b;
 	}
 	
-	// fill new node
-	
-	newNode->num = num;
-	newNode->left = NULL;
-	newNode->right = NULL;
-	
-	return (newNode);
+	else
+	{
+		return compare (a, b);
+	}
 }
 
 //*****************************************************************************
-//  FUNCTION:	  InsertNode
-//  DESCRIPTION:  inserts a new node into the tree
-//  INPUT:        Parameters:	newTree - pointer to new binary tree
-//								insertNum - integer being added	to tree
-//  OUTPUT: 	  Return value: none
-//  CALLS TO:	  CreateNode
+//  FUNCTION:	  BinaryTree::Equal
+//  DESCRIPTION:  determines whether two keys are equivalent
+//  INPUT:        Parameters:	a, b - keys being compared
+//  OUTPUT: 	  Return value: true (if neither key is ordered before the other)
+//  CALLS TO:	  Less
 //*****************************************************************************
 
-void InsertNode (binaryTree *newTree, int insertNum)
+template <class Key, class Value, class Compare, class Allocator>
+bool BinaryTree<Key, Value, Compare, Allocator>::Equal (const Key& a, const Key& b) const
 {
-	node* current;	// pointer to current node
-	node* parent;	// pointer to parent node
-	node* newNode;	// pointer to new node
-	
-	// call CreateNode
-	
-	newNode = CreateNode (insertNum);
-	
-	// empty binary tree
-	// add new node
-	
-	if (newTree->root == NULL)
+	if constexpr (plainKey)
 	{
-		newTree->root = newNode;
-		newTree->count++;
+		return a == b;
 	}
 	
 	else
 	{
-		// traverse tree until appropriate
-		// leaf position is found
-		
-		current = newTree->root;
-		newTree->count++;
-		
-		while (current != NULL)
-		{
-			parent = current;
-			
-			// duplicate is found
-			
-			if (current->num == insertNum)
-			{
-				cout << endl;
-				cerr << insertNum << " is already in the list ";
-				cerr << "duplicates are not allowed." << endl;
-				newTree->count--;
-				return;	
-			}
-			
-			else if (current->num > insertNum)
-			{
-				current = current->left;
-			}
-			
-			else
-			{
-				current = current->right;
-			}
-		}
-		
-		// link the new child to its parent
-		
-		if (parent->num > insertNum)
+		return !Less (a, b) && !Less (b, a);
+	}
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::Locate
+//  DESCRIPTION:  finds the link that holds, or would hold, a key
+//  INPUT:        Parameters:	key - key being searched for
+//  OUTPUT: 	  Return value: pointer to the matching link
+//								(points to NULL if key is not found)
+//  CALLS TO:	  Equal, Less
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+typename BinaryTree<Key, Value, Compare, Allocator>::treeNode**
+BinaryTree<Key, Value, Compare, Allocator>::Locate (const Key& key) const
+{
+	treeNode **link = const_cast<treeNode**> (&root);	// current link
+	treeNode *current = root;							// node behind link
+	
+	while (current != NULL && !Equal (current->entry.first, key))
+	{
+		if (Less (key, current->entry.first))
 		{
-			parent->left = newNode;
+			link = &current->left;
+			current = current->left;
 		}
 		
 		else
 		{
-			parent->right = newNode;
+			link = &current->right;
+			current = current->right;
 		}
 	}
+	
+	return link;
 }
 
 //*****************************************************************************
-//  FUNCTION:	  FindNode
-//  DESCRIPTION:  searches for a value in the tree
-//  INPUT:        Parameters:	newTree - pointer to new binary tree
-//								searchNum - integer being searched for
-//  OUTPUT: 	  Return value: found - true (if integer is found)
-//									  - false (if integer is not found)
-//  CALLS TO:	  none
+//  FUNCTION:	  BinaryTree::Emplace
+//  DESCRIPTION:  constructs a value in place under a new key; nothing is
+//				  allocated or constructed if the key is a duplicate
+//  INPUT:        Parameters:	key - key being added (copied or moved)
+//								args - constructor arguments for the value
+//  OUTPUT: 	  Return value: pointer to the stored value and
+//								true (if added) / false (if duplicate)
+//  CALLS TO:	  EmplaceKey
 //*****************************************************************************
 
-bool FindNode (binaryTree *newTree, int searchNum)
+template <class Key, class Value, class Compare, class Allocator>
+template <class... Args>
+pair<Value*, bool>
+BinaryTree<Key, Value, Compare, Allocator>::Emplace (const Key& key, Args&&... args)
 {
-	node *current;		// pointer to current node
-	bool found = false;	// integer found or not found 
+	return EmplaceKey (key, std::forward<Args>(args)...);
+}
+
+template <class Key, class Value, class Compare, class Allocator>
+template <class... Args>
+pair<Value*, bool>
+BinaryTree<Key, Value, Compare, Allocator>::Emplace (Key&& key, Args&&... args)
+{
+	return EmplaceKey (std::move (key), std::forward<Args>(args)...);
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::EmplaceKey
+//  DESCRIPTION:  links a new node for a key that is not yet in the tree
+//  INPUT:        Parameters:	key - key being added (forwarded into the node)
+//								args - constructor arguments for the value
+//  OUTPUT: 	  Return value: pointer to the stored value and
+//								true (if added) / false (if duplicate)
+//  CALLS TO:	  Locate
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+template <class K, class... Args>
+pair<Value*, bool>
+BinaryTree<Key, Value, Compare, Allocator>::EmplaceKey (K&& key, Args&&... args)
+{
+	treeNode **link = Locate (key);		// slot for the new node
+	treeNode *newNode;					// pointer to new node
 	
-	// Error message displays if binary tree is empty
+	// duplicate is found
 	
-	if (newTree->root == NULL)
+	if (*link != NULL)
 	{
-		cout << endl;
-		cerr << "Cannot search an empty tree." << endl;
+		return make_pair (&(*link)->entry.second, false);
 	}
 	
-	else
+	// allocate and construct the new node
+	
+	newNode = nodeTraits::allocate (alloc, 1);
+	
+	try
 	{
-		current = newTree->root;
-		
-		while (current != NULL && !found)
-		{
-			// current->num == searchNum
-			
-			if (current->num == searchNum)
-			{
-				found = true;
-			}
-			
-			// traverse current->left
-			
-			else if (current->num > searchNum)
-			{
-				current = current->left;
-			}
-			
-			// traverse current->right
-			
-			else
-			{
-				current = current->right;
-			}
-		}
+		nodeTraits::construct (alloc, newNode, std::forward<K>(key), std::forward<Args>(args)...);
 	}
 	
-	return found;
+	catch (...)
+	{
+		nodeTraits::deallocate (alloc, newNode, 1);
+		throw;
+	}
+	
+	*link = newNode;
+	count++;
+	
+	return make_pair (&newNode->entry.second, true);
 }
 
 //*****************************************************************************
-//  FUNCTION:	  DeleteNode
-//  DESCRIPTION:  deletes a node from the tree
-//  INPUT:        Parameters:	newTree - pointer to new binary tree	
-//  OUTPUT: 	  Return value: none
-//  CALLS TO:	  none
+//  FUNCTION:	  BinaryTree::Insert
+//  DESCRIPTION:  inserts a key/value pair into the tree
+//  INPUT:        Parameters:	key - key being added
+//								value - value being moved or copied in
+//  OUTPUT: 	  Return value: pointer to the stored value and
+//								true (if added) / false (if duplicate)
+//  CALLS TO:	  Emplace
 //*****************************************************************************
 
-void DeleteNode (binaryTree* newTree)
+template <class Key, class Value, class Compare, class Allocator>
+pair<Value*, bool>
+BinaryTree<Key, Value, Compare, Allocator>::Insert (const Key& key, Value&& value)
 {
-	node *current;		// pointer to current node
-	node *parent;		// pointer to parent node
-	node* temp;			// pointer to node to be deleted
-	
-	// error messages displays - node is NULL
+	return Emplace (key, std::move (value));
+}
+
+template <class Key, class Value, class Compare, class Allocator>
+pair<Value*, bool>
+BinaryTree<Key, Value, Compare, Allocator>::Insert (const Key& key, const Value& value)
+{
+	return Emplace (key, value);
+}
+
+template <class Key, class Value, class Compare, class Allocator>
+pair<Value*, bool>
+BinaryTree<Key, Value, Compare, Allocator>::Insert (Key&& key, Value&& value)
+{
+	return Emplace (std::move (key), std::move (value));
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::Find
+//  DESCRIPTION:  searches for a key in the tree
+//  INPUT:        Parameters:	key - key being searched for
+//  OUTPUT: 	  Return value: pointer to the stored value
+//								NULL - key is not found
+//  CALLS TO:	  Locate
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+Value* BinaryTree<Key, Value, Compare, Allocator>::Find (const Key& key)
+{
+	treeNode *found = *Locate (key);	// matching node
 	
-	if (newTree->root == NULL)
-	{
-		cout << endl;
-		cerr << "Error: The node to be deleted is NULL." << endl;
-		return;
-	}
+	return found != NULL ? &found->entry.second : NULL;
+}
+
+template <class Key, class Value, class Compare, class Allocator>
+const Value* BinaryTree<Key, Value, Compare, Allocator>::Find (const Key& key) const
+{
+	const treeNode *found = *Locate (key);	// matching node
 	
-	// no leaf and right subtrees
+	return found != NULL ? &found->entry.second : NULL;
+}
+
+//*****************************************************************************
+//  FUNCTION:	  BinaryTree::Delete
+//  DESCRIPTION:  deletes a key from the tree; trivially copyable entries
+//				  take the in-order predecessor's entry like RemoveNode,
+//				  other entries relink the predecessor's node in place of
+//				  the deleted one, so move-only keys and values are never
+//				  copied
+//  INPUT:        Parameters:	key - key being deleted
+//  OUTPUT: 	  Return value: true (if deleted) / false (if not found)
+//  CALLS TO:	  Locate
+//*****************************************************************************
+
+template <class Key, class Value, class Compare, class Allocator>
+bool BinaryTree<Key, Value, Compare, Allocator>::Delete (const Key& key)
+{
+	treeNode **link = Locate (key);		// link to node being deleted
+	treeNode **predLink;				// link to in-order predecessor
+	treeNode *temp = *link;				// node being deleted
+	treeNode *pred;						// in-order predecessor
 	
-	else if (newTree->root->left == NULL && newTree->root->right == NULL)
+	if (temp == NULL)
 	{
-		temp = newTree->root;
-		temp = NULL;
-		newTree->count--;
-		delete temp;
-		
+		return false;
 	}
 	
-	// no leaf subtree
+	// no left subtree
 	
-	else if (newTree->root->left == NULL)
+	if (temp->left == NULL)
 	{
-		temp = newTree->root;
-		newTree->root = temp->right;
-		newTree->count--;
-		delete temp;
+		*link = temp->right;
 	}
 	
 	// no right subtree
 	
-	else if (newTree->root->right == NULL)
+	else if (temp->right == NULL)
 	{
-		temp = newTree->root;
-		newTree->root = temp->left;
-		newTree->count--;
-		delete temp;
+		*link = temp->left;
 	}
 	
 	// nonempty left and right subtrees
+	// replace with the in-order predecessor
 	
 	else
 	{
-		current = newTree->root->left;
-		parent = NULL;
+		predLink = &temp->left;
 		
-		while (current->right != NULL)
+		while ((*predLink)->right != NULL)
 		{
-			parent = current;
-			current = current->right;
+			predLink = &(*predLink)->right;
 		}
 		
-		newTree->root->num = current->num;
+		pred = *predLink;
+		*predLink = pred->left;
 		
-		if (parent == NULL)
+		// trivial entries - the predecessor's entry moves, its node is freed
+		
+		if constexpr (is_trivially_copyable<Key>::value && is_trivially_copyable<Value>::value)
 		{
-			newTree->root->left = current->left;
+			::new ((void*)&temp->entry) pair<const Key, Value> (pred->entry);
+			temp = pred;
 		}
 		
 		else
 		{
-			parent->right = current->left;
+			pred->left = temp->left;
+			pred->right = temp->right;
+			*link = pred;
 		}
-		
-		newTree->count--;
-		
-		delete current;
 	}
+	
+	nodeTraits::destroy (alloc, temp);
+	nodeTraits::deallocate (alloc, temp, 1);
+	count--;
+	
+	return true;
 }
 
 //*****************************************************************************
-//  FUNCTION:	  InOrderDisplay
-//  DESCRIPTION:  displays all integers in tree (recursive in-order)
-//  INPUT:        Parameters:	root - pointer to root node
+//  FUNCTION:	  BinaryTree::InOrder
+//  DESCRIPTION:  visits all key/value pairs in key order; the nodes
+//				  whose entry is not yet visited are kept in a vector
+//  INPUT:        Parameters:	visit - called with (key, value) for each entry
 //  OUTPUT: 	  Return value: none
 //  CALLS TO:	  none
 //*****************************************************************************
 
-void InOrderDisplay (node* root)
+template <class Key, class Value, class Compare, class Allocator>
+template <class Visit>
+void BinaryTree<Key, Value, Compare, Allocator>::InOrder (Visit visit) const
 {
-	static int lastDisplayed = INT_MIN;
-
-	if (root != NULL)
+	vector<const treeNode*> pending;		// ancestors not yet visited
+	const treeNode *current = root;			// next subtree to descend
+	
+	while (current != NULL || !pending.empty())
 	{
-		InOrderDisplay (root->left);
+		while (current != NULL)
+		{
+			pending.push_back (current);
+			current = current->left;
+		}
 		
-		cout << setw(7) << root->num << " ";
-		lastDisplayed = root->num;
-			
-		InOrderDisplay (root->right);
-	}	
+		current = pending.back();
+		pending.pop_back();
+		visit (current->entry.first, current->entry.second);
+		current = current->right;
+	}
 }
 
 //*****************************************************************************
-//  FUNCTION:	  FreeNodes
-//  DESCRIPTION:  recursively de-allocates all memory from the tree
-//  INPUT:        Parameters:	root - pointer to root node
+//  FUNCTION:	  BinaryTree::Clear
+//  DESCRIPTION:  de-allocates all nodes from the tree
+//  INPUT:        Parameters:	none
 //  OUTPUT: 	  Return value: none
-//  CALLS TO:	  none
+//  CALLS TO:	  FreeNodes
 //*****************************************************************************
 
-void FreeNodes (node* root)
+template <class Key, class Value, class Compare, class Allocator>
+void BinaryTree<Key, Value, Compare, Allocator>::Clear()
 {
-	if (root != NULL)
-	{
-		FreeNodes (root->left);
-		FreeNodes (root->right);
-		delete root;
-		root = NULL;
-	}
+	FreeNodes (root);
+	root = NULL;
+	count = 0;
 }
 
 //*****************************************************************************
-//  FUNCTION:	  DestroyTree
-//  DESCRIPTION:  de-allocates all nodes from the tree
-//  INPUT:        Parameters:	newTree - pointer to new binary tree 
+//  FUNCTION:	  BinaryTree::FreeNodes
+//  DESCRIPTION:  de-allocates a subtree without recursion; left children
+//				  are rotated up until the root has none, then it is freed
+//  INPUT:        Parameters:	root - root of subtree
 //  OUTPUT: 	  Return value: none
-//  CALLS TO:	  FreeNodes
+//  CALLS TO:	  none
 //*****************************************************************************
 
-void DestroyTree (binaryTree* newTree)
+template <class Key, class Value, class Compare, class Allocator>
+void BinaryTree<Key, Value, Compare, Allocator>::FreeNodes (treeNode* root)
 {
-	FreeNodes (newTree->root);
+	treeNode *child;		// left child being rotated up
+	
+	while (root != NULL)
+	{
+		if (root->left != NULL)
+		{
+			child = root->left;
+			root->left = child->right;
+			child->right = root;
+			root = child;
+		}
+		
+		else
+		{
+			child = root->right;
+			nodeTraits::destroy (alloc, root);
+			nodeTraits::deallocate (alloc, root, 1);
+			root = child;
+		}
+	}
 }